@@ -0,0 +1,107 @@
+// Temp_Concurrent_Storage against a Temp_Storage guarded by a mutex, at 1-64 threads.
+// Build and run: c++ -std=c++11 -O2 -I.. concurrent_alloc_bench.cpp -o concurrent_alloc_bench -pthread && ./concurrent_alloc_bench
+#define TEMP_ALLOC_IMPLEMENTATION
+#include "temp_alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const size_t ALLOCATIONS_PER_FRAME = 1 << 18; // Split between the threads.
+static const int    FRAMES = 20;
+static const size_t PAGE_CAPACITY = 8 * 1024 * 1024;
+
+static std::atomic<size_t> g_page_allocations(0);
+
+static void* counting_alloc(size_t size)
+{
+    g_page_allocations += 1;
+    return malloc(size);
+}
+
+// Sizes between 16 and 256 bytes, the same sequence for both versions.
+static size_t allocation_size(size_t index)
+{
+    return 16 + (index * 2654435761u >> 8) % 241;
+}
+
+template<class alloc_proc_type>
+static double run_frames(int thread_count, alloc_proc_type alloc_proc, void (*reset_proc)())
+{
+    const size_t per_thread = ALLOCATIONS_PER_FRAME / thread_count;
+    double total_seconds = 0.0;
+
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        std::vector<std::thread> threads;
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+
+        for (int t = 0; t < thread_count; t++)
+        {
+            threads.emplace_back([&, t]()
+            {
+                ready += 1;
+                while (!go.load())
+                    std::this_thread::yield();
+
+                for (size_t i = 0; i < per_thread; i++)
+                {
+                    char* memory = (char*)alloc_proc(allocation_size(t * per_thread + i));
+                    memory[0] = (char)i;
+                }
+            });
+        }
+
+        while (ready.load() != thread_count)
+            std::this_thread::yield();
+
+        const auto start = std::chrono::steady_clock::now();
+        go = true;
+        for (std::thread& thread : threads)
+            thread.join();
+        total_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        reset_proc();
+    }
+
+    return total_seconds;
+}
+
+static Temp_Concurrent_Storage g_concurrent;
+static Temp_Storage g_locked;
+static std::mutex g_lock;
+
+int main()
+{
+    temp_concurrent_init(&g_concurrent, PAGE_CAPACITY);
+    g_concurrent.alloc_proc = &counting_alloc;
+
+    temp_storage_init(&g_locked, PAGE_CAPACITY);
+
+    printf("threads   concurrent ns/alloc   mutex ns/alloc   concurrent pages/frame\n");
+    for (int thread_count = 1; thread_count <= 64; thread_count *= 2)
+    {
+        g_page_allocations = 0;
+        const double concurrent_seconds = run_frames(thread_count,
+            [](size_t size) { return temp_concurrent_alloc(&g_concurrent, size); },
+            []() { temp_concurrent_reset(&g_concurrent); });
+        const double pages_per_frame = (double)g_page_allocations.load() / FRAMES;
+
+        const double locked_seconds = run_frames(thread_count,
+            [](size_t size) { std::lock_guard<std::mutex> guard(g_lock); return temp_storage_alloc(&g_locked, size); },
+            []() { temp_storage_reset(&g_locked); });
+
+        const double allocations = (double)(ALLOCATIONS_PER_FRAME / thread_count * thread_count) * FRAMES;
+        printf("%7d   %20.2f   %14.2f   %22.1f\n", thread_count,
+               concurrent_seconds * 1e9 / allocations, locked_seconds * 1e9 / allocations, pages_per_frame);
+    }
+
+    temp_concurrent_deinit(&g_concurrent);
+    temp_storage_deinit(&g_locked);
+    return 0;
+}
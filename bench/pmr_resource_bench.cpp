@@ -0,0 +1,75 @@
+// Temp_Memory_Resource against std::pmr::monotonic_buffer_resource, both reset every frame.
+// Build and run: c++ -std=c++17 -O2 -I.. pmr_resource_bench.cpp -o pmr_resource_bench && ./pmr_resource_bench
+#define TEMP_ALLOC_IMPLEMENTATION
+#include "temp_alloc.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static const int FRAMES = 200;
+static const int ELEMENTS = 20000;
+static const size_t CAPACITY = 64 * 1024 * 1024;
+
+static volatile size_t g_sink;
+
+// A frame worth of typical temporary containers.
+static size_t run_frame(std::pmr::memory_resource* resource)
+{
+    std::pmr::vector<int> numbers(resource);
+    for (int i = 0; i < ELEMENTS; i++)
+        numbers.push_back(i);
+
+    std::pmr::vector<std::pmr::string> names(resource);
+    names.reserve(ELEMENTS / 10);
+    for (int i = 0; i < ELEMENTS / 10; i++)
+        names.emplace_back("some temporary name that doesn't fit in sso");
+
+    std::pmr::unordered_map<int, int> lookup(resource);
+    for (int i = 0; i < ELEMENTS; i++)
+        lookup[i * 7] = i;
+
+    return numbers.size() + names.size() + lookup.size();
+}
+
+template<class reset_proc_type>
+static double ms_per_frame(std::pmr::memory_resource* resource, reset_proc_type reset_proc)
+{
+    size_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        sink += run_frame(resource);
+        reset_proc();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    g_sink = sink;
+    return seconds * 1e3 / FRAMES;
+}
+
+int main()
+{
+    Temp_Storage storage = { 0 };
+    temp_storage_init(&storage, CAPACITY);
+    Temp_Memory_Resource temp_resource(&storage);
+
+    // Same up front buffer for the monotonic resource, so neither of them goes to the heap after the first frame.
+    std::vector<char> buffer(CAPACITY);
+    std::pmr::monotonic_buffer_resource monotonic_resource(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    // Warm up both, so the memory is touched.
+    ms_per_frame(&temp_resource, [&]() { temp_storage_reset(&storage); });
+    ms_per_frame(&monotonic_resource, [&]() { monotonic_resource.release(); });
+
+    printf("resource                      ms/frame\n");
+    printf("Temp_Memory_Resource          %8.3f\n", ms_per_frame(&temp_resource, [&]() { temp_storage_reset(&storage); }));
+    printf("monotonic_buffer_resource     %8.3f\n", ms_per_frame(&monotonic_resource, [&]() { monotonic_resource.release(); }));
+
+    temp_storage_deinit(&storage);
+    return 0;
+}
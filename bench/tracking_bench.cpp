@@ -0,0 +1,87 @@
+// Per call cost of temp_alloc() and the inline versions with the allocation info tracking on, off at runtime, and compiled out.
+// Build and run both configurations:
+//   c++ -std=c++11 -O2 -I.. tracking_bench.cpp -o tracking_bench && ./tracking_bench
+//   c++ -std=c++11 -O2 -I.. -DTEMP_ALLOC_TRACK_INFO=0 tracking_bench.cpp -o tracking_bench_off && ./tracking_bench_off
+#define TEMP_ALLOC_IMPLEMENTATION
+#include "temp_alloc.h"
+
+#include <stdio.h>
+#include <chrono>
+
+static const size_t ALLOCATIONS_PER_FRAME = 100000;
+static const int    FRAMES = 200;
+
+// Keeps the compiler from throwing the allocations away.
+static volatile uintptr_t g_sink;
+
+enum Path
+{
+    PATH_CALL,
+    PATH_INLINE,
+    PATH_INLINE_CONSTANT_SIZE,
+    PATH_INLINE_ALIGNED,
+};
+
+template<Path path>
+static void* allocate(size_t size)
+{
+    switch (path)
+    {
+    case PATH_CALL:                 return temp_alloc(size);
+    case PATH_INLINE:               return temp_alloc_inline(size);
+    case PATH_INLINE_CONSTANT_SIZE: return temp_alloc_inline(32);
+    case PATH_INLINE_ALIGNED:       return temp_alloc_aligned_inline(size, 32);
+    }
+    return NULL;
+}
+
+template<Path path>
+static double ns_per_call()
+{
+    uintptr_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        for (size_t i = 0; i < ALLOCATIONS_PER_FRAME; i++)
+        {
+            const size_t size = 16 + (i & 63);
+            void* memory = allocate<path>(size);
+            sink += (uintptr_t)memory;
+        }
+        temp_reset();
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    g_sink = sink;
+    return seconds * 1e9 / ((double)ALLOCATIONS_PER_FRAME * FRAMES);
+}
+
+int main()
+{
+    // Big enough that every frame fits in the main block, so we only measure the call itself.
+    temp_init(64 * 1024 * 1024);
+
+    printf("TEMP_ALLOC_TRACK_INFO=%d\n", TEMP_ALLOC_TRACK_INFO);
+    printf("mode             temp_alloc   inline   inline (size 32)   inline aligned (32)   (ns per call)\n");
+
+    temp_track_allocation_info(false);
+    ns_per_call<PATH_CALL>(); // Warm up, touches the main block.
+    const double call_ns = ns_per_call<PATH_CALL>();
+    const double inline_ns = ns_per_call<PATH_INLINE>();
+    const double constant_ns = ns_per_call<PATH_INLINE_CONSTANT_SIZE>();
+    const double aligned_ns = ns_per_call<PATH_INLINE_ALIGNED>();
+    printf("tracking off     %10.2f   %6.2f   %16.2f   %19.2f\n", call_ns, inline_ns, constant_ns, aligned_ns);
+
+#if TEMP_ALLOC_TRACK_INFO
+    temp_track_allocation_info(true);
+    const double tracked_call_ns = ns_per_call<PATH_CALL>();
+    const double tracked_inline_ns = ns_per_call<PATH_INLINE>();
+    const double tracked_constant_ns = ns_per_call<PATH_INLINE_CONSTANT_SIZE>();
+    const double tracked_aligned_ns = ns_per_call<PATH_INLINE_ALIGNED>();
+    printf("tracking on      %10.2f   %6.2f   %16.2f   %19.2f\n", tracked_call_ns, tracked_inline_ns, tracked_constant_ns, tracked_aligned_ns);
+#endif
+
+    temp_deinit();
+    return 0;
+}
@@ -3,9 +3,18 @@
     It is highly recomended to set the max_capacity value according to the memory usage in your game/app, because the less allocations we do,
     the faster it will perform. Also there is less free() calls, less memory fragmentation and so on.
     All this information is available with temp_track_allocation_info() and temp_get_alloc_info() procedures.
+    Define TEMP_ALLOC_TRACK_INFO to 0 (in every file that includes temp_alloc.h) to compile the tracking out of the allocation
+    path completely for your release builds. temp_track_allocation_info() doesn't do anything then.
 
     Some Notes:
-        * This library uses a global Temp_Storage object, so it's not really thread safe.
+        * The temp_* procedures use a global Temp_Storage object, so they're not really thread safe.
+          If you need separate arenas (e.g. one per subsystem), use the temp_storage_* procedures described below.
+        * Define TEMP_ALLOC_THREAD_LOCAL (in every file that includes temp_alloc.h) to make the global Temp_Storage thread local.
+          Every thread then gets its own arena, which is initialized lazily on the first temp_alloc() call in that thread
+          with the capacity that was passed to temp_init(). There is no locking at all, each thread just bumps its own pointer.
+          Each thread has to call temp_reset() itself. In C++ the thread arena is freed automatically when the thread exits,
+          in C you have to call temp_deinit() before the thread exits.
+          NOTE: temp_set_alloc_proc/temp_set_free_proc/temp_track_allocation_info only affect the calling thread then.
 
     How to use this:
     * create a file and define TEMP_ALLOC_IMPLEMENTATION in it, then include temp_alloc.h.
@@ -14,11 +23,45 @@
     * From now on, just include temp_alloc.h everywhere you want to.
     * call temp_init(size_t given_capacity) to initialize the allocator.
       if given_capacity is set to 0, then DEFAULT_TEMP_ALLOC_CAPACITY_SIZE will be used. It is 64 MB for now.
-    * temp_alloc(size_t size) to allocate memory in bytes.
-    * temp_free() doesn't do anything. It needed only for the stl allocator.
+    * temp_alloc(size_t size) to allocate memory in bytes. The memory is aligned to ALIGMENT_BYTES.
+    * temp_alloc_aligned(size_t size, size_t alignment) to allocate memory with any power of two alignment (e.g. 32/64 for SIMD
+      or cache line aligned data). The bump pointer is just moved forward to the next aligned address.
+      temp_alloc_stl uses it automatically for over-aligned types.
+      NOTE: temp_realloc() doesn't keep the alignment if it has to copy.
+    * temp_alloc_inline(size_t size) / temp_storage_alloc_inline(Temp_Storage*, size_t size) are the same as temp_alloc, but the
+      common case (the allocation fits in the current page) is inlined right into your code: it only reads at and end and only
+      writes at. Everything else (and everything while tracking is on) goes to temp_alloc(). Measure it with
+      bench/tracking_bench.cpp before you reach for it, an out of line call is not much slower on most machines.
+      temp_alloc_aligned_inline(size_t size, size_t alignment) / temp_storage_alloc_aligned_inline() do the same for
+      temp_alloc_aligned().
+      NOTE: the inline path doesn't remember the last allocation, so temp_free() can't give it back. Use temp_free_size().
+    * temp_free(void* memory) only gives the memory back if it is the last allocation (LIFO), otherwise it doesn't do anything.
+      temp_free_size(void* memory, size_t size) does the same, but it also works for the block right below the top after a
+      previous free, since it knows where the block ends. The stl allocator uses that one.
       This allacator is not really design to free things, so you know...
     * temp_realloc(void* old_memory, size_t old_size, size_t new_size) will reallocate your memory. But note: it won't free anything! So the data won't change or anything.
+      If old_memory is the last allocation and there is enough space after it, it's grown (or shrunk) in place without copying.
+      temp_resize_in_place(void* memory, size_t old_size, size_t new_size) only does the in place part and returns false if it
+      can't, so you can move the data yourself (for C++ objects that can't just be memcpy'd).
     * temp_reset() to reset the allocator. Usually you would want to call this at the end of your game/app loop.
+    * temp_get_mark() returns the current position of the allocator and temp_set_mark(Temp_Mark mark) rewinds back to it.
+      Everything allocated after the mark is gone, and the overflow pages allocated after it are released (or retained, see
+      page_retention_budget). Use it for scratch memory of inner loops, so every iteration reuses the same cache-hot bytes:
+        for (...)
+        {
+            Temp_Mark mark = temp_get_mark();
+            do_stuff_with_temp_memory();
+            temp_set_mark(mark);
+        }
+      Marks have to be restored in LIFO order and they are invalid after temp_reset().
+      A block allocated before the innermost mark never grows in place (temp_set_mark() would cut it), so temp_realloc() copies
+      it and temp_resize_in_place() returns false.
+      In C++ you can use Temp_Scope instead, it takes the mark in its constructor and restores it in its destructor:
+        for (...)
+        {
+            Temp_Scope scope;
+            do_stuff_with_temp_memory();
+        }
     * temp_deinit() to free all the memory and deinit the allocator.
     * temp_printf(const char* format, ...) will return a formatted temporary string.
     * temp_copy_string(const char* c_string) will return a copied temporary string.
@@ -29,6 +72,70 @@
         temp_vec.push_back(10);
         temp_vec.push_back(15);
         temp_vec.push_back(11);
+      temp_storage_alloc_stl does the same with a specific storage. It remembers the storage, so two of them are only equal
+      if they use the same one (moving/swapping containers with equal allocators just swaps the buffers):
+        std::vector<int, temp_storage_alloc_stl<int>> temp_vec(temp_storage_alloc_stl<int>(&storage));
+      With C++23 it also has allocate_at_least, so containers can use the bytes the allocation gets rounded up to.
+
+    * Temp_Array<T> is a vector that knows about the allocator. While it's the last allocation, growing it just moves the
+      top of the arena, so nothing is copied and no old buffers are left behind. It only moves the elements when something
+      else was allocated after it:
+        Temp_Array<Object*> visible;                            // or Temp_Array<Object*> visible(storage);
+        for (Object* object : objects)
+            if (is_visible(object))
+                visible.push_back(object);
+        visible.shrink_to_fit();                                // gives the unused capacity back
+      The same rule as for the stl containers applies, destroy it before resetting the storage.
+      NOTE: An array that outlives a Temp_Scope (or a mark) must not relocate inside it, the new buffer would be given back with
+      the scope. It can't grow in place there either, since it's below the mark. So reserve() what the scope is going to add
+      before entering it:
+        Temp_Array<Object*> visible;
+        visible.reserve(object_count);
+        for (...)
+        {
+            Temp_Scope scope;
+            ...
+            visible.push_back(object);                          // fits, nothing moves
+        }
+
+    * Temp_List<T> is for when you just keep appending and don't know how many there will be. The elements live in chunks of
+      TEMP_LIST_CHUNK_BYTES (or Temp_List<T, count> elements) that are linked together, so appending never moves or copies
+      anything and pointers to the elements stay valid. Iterate it with a range for (or walk list.first->next... yourself),
+      and once you're done call flatten() to get all of it in one exactly sized array:
+        Temp_List<Particle> alive;
+        ...
+        alive.push_back(particle);
+        ...
+        Particle* particles = alive.flatten();                  // alive.size() elements
+
+    * Temp_Hash_Map<K, V> and Temp_Hash_Set<K> are flat open addressing hash tables in the storage, for the per frame
+      lookup and dedup tables. They check 16 slots at once (with SSE2 when it's there), and there is no remove: you fill
+      them, query them and throw them away with the frame. reserve() them if you know the count, every growth leaves the
+      old table behind until the reset:
+        Temp_Hash_Set<Mesh*> seen;
+        seen.reserve(draw_count);
+        for (Draw& draw : draws)
+            if (seen.insert(draw.mesh))
+                upload(draw.mesh);
+        Temp_Hash_Map<uint32_t, int> index_of;
+        index_of[id] = 10;
+        int* index = index_of.get(id);                          // NULL if it's not there
+      Keys are hashed with std::hash (or the hasher you pass) and compared with ==.
+
+    * Temp_String_Builder builds a string at the top of the storage. Unlike temp_printf()/temp_copy_string(), the pieces don't
+      become separate strings, each append just extends the same buffer in place (it only moves if you allocate something
+      else in the middle of building):
+        Temp_String_Builder builder;                            // or Temp_String_Builder builder(storage);
+        builder.append("frame ").append_int(frame_index).append_fmt(" took %.2f ms", ms).append('\n');
+        char* line = builder.finish();                          // 0 terminated, the rest of the buffer is given back
+      A builder that is dropped without finish() gives its buffer back if it's still on top.
+      Like Temp_Array, a builder that outlives a Temp_Scope must not grow inside it. reserve() the space before the scope.
+
+    * With C++17 you can use Temp_Memory_Resource with the std::pmr containers instead, so your container types don't change:
+        Temp_Memory_Resource temp_resource;                      // or Temp_Memory_Resource temp_resource(storage);
+        std::pmr::vector<int> temp_vec(&temp_resource);
+      Over-aligned types get properly aligned memory and freeing the last allocation gives the memory back (see temp_free_size).
+      Two resources on the same storage compare equal, except with RTTI turned off (-fno-rtti), then only the same object does.
 
     NOTE: This is important!!!
         Your stl contaier HAS to be destroyed before resetting the temporary storage!!
@@ -36,14 +143,162 @@
 
     * temp_set_alloc_proc will set your allocation procedure callback when allocating memory. It's standart malloc by default.
     * temp_set_free_proc  will set your free procedure callback when allocating memory. It's standart free by default.
+
+    * temp_init_with_options(const Temp_Options* options) initializes the allocator with extra settings. A zeroed Temp_Options
+      gives you the same behaviour as temp_init(0):
+        Temp_Options options = { 0 };
+        options.capacity = 16 * 1024 * 1024;
+        options.page_retention_budget = 64 * 1024 * 1024; // keep up to 64 MB of overflow pages around after temp_reset()
+        temp_init_with_options(&options);
+      Retained overflow pages are reused by the next frames instead of being allocated again, so if your spikes are recurring
+      the allocator stops calling alloc_proc/free_proc at all. See overflow_pages_allocated/overflow_pages_reused in Temp_Alloc_Info.
+      With options.adaptive_capacity set, temp_reset() reallocates the main block when the frame didn't fit in it, so chronic
+      overflow turns into one contiguous block. The block is sized from a high water mark that decays over the following frames,
+      and it shrinks back (never below options.capacity) once the usage stays well below it.
+      See TEMP_ADAPTIVE_GROW_PERCENT, TEMP_ADAPTIVE_DECAY_SHIFT and TEMP_ADAPTIVE_SHRINK_RATIO.
+      With options.backend = TEMP_BACKEND_VIRTUAL the main block is not allocated with alloc_proc. Instead options.capacity bytes
+      of address space are reserved (mmap/VirtualAlloc), and pages get committed in TEMP_COMMIT_GRANULARITY steps as the
+      allocator moves forward. Allocations stay contiguous and never move, there are no overflow pages (unless the whole
+      reservation is used up) and only the memory you actually touched is resident.
+      In this mode capacity 0 means DEFAULT_TEMP_ALLOC_RESERVE_SIZE.
+      With options.huge_pages set, the main block and the overflow pages are mapped directly from the OS with 2 MB pages to cut down
+      TLB misses. We try explicit huge pages first (MAP_HUGETLB / MEM_LARGE_PAGES) and fall back to transparent huge pages
+      (madvise(MADV_HUGEPAGE)) and then to normal pages. Check main_block_backing in Temp_Alloc_Info to see what you've got.
+      alloc_proc/free_proc are not used for these blocks then.
+      With options.trim_memory set, temp_reset() gives memory the last frames didn't need back to the OS, so the resident memory
+      follows the actual load instead of the worst frame ever. It uses the same decaying high water mark as adaptive_capacity:
+        - TEMP_BACKEND_VIRTUAL decommits the main block beyond the mark.
+        - A huge_pages main block gets madvise(MADV_DONTNEED) beyond the mark (a plain alloc_proc block is left alone).
+        - Retained overflow pages that the mark says we don't need anymore are freed.
+      Nothing is trimmed until there are at least TEMP_TRIM_MIN_BYTES to give back. See trimmed_bytes in Temp_Alloc_Info.
+      options.page_growth decides how big the overflow pages are:
+        - TEMP_PAGE_GROWTH_FIXED:     every page is options.page_size bytes (the default).
+        - TEMP_PAGE_GROWTH_GEOMETRIC: every next page in a frame is twice as big as the previous one, so even a huge overflow
+                                      takes just a handful of pages.
+        - TEMP_PAGE_GROWTH_CAPPED:    like geometric, but the pages stop growing at options.max_page_size.
+      options.page_size 0 means the main block capacity (DEFAULT_TEMP_ALLOC_CAPACITY_SIZE for TEMP_BACKEND_VIRTUAL),
+      options.max_page_size 0 means TEMP_DEFAULT_MAX_PAGE_SIZE_FACTOR * page_size.
+      With options.large_allocation_threshold set, allocations of at least that many bytes get their own block (from the retained
+      pages or alloc_proc) instead of going through the bump pages, so they don't throw away the rest of the current page.
+      These blocks are released on temp_reset() and temp_set_mark() like the overflow pages.
+      NOTE: temp_alloc_inline() only does this check when the allocation doesn't fit in the current page.
+    * When an allocation doesn't fit in the current page, the space left at the end of it is not lost right away. The allocator keeps
+      up to TEMP_MAX_TAILS of these tails (if they are at least TEMP_MIN_TAIL_SIZE bytes) and tries them before it moves to a new
+      overflow page. See wasted_bytes/tail_reused_bytes in Temp_Alloc_Info. The tails are dropped on temp_reset()/temp_set_mark().
+
+    * Every temp_* procedure has a temp_storage_* version that takes an explicit Temp_Storage*.
+      The temp_* procedures are just wrappers over the default storage (see temp_get_default_storage()).
+      This way every subsystem can have its own arena and reset it whenever it wants to:
+        Temp_Storage* audio_storage = temp_storage_create(0);
+        float* samples = (float*)temp_storage_alloc(audio_storage, 1024 * sizeof(float));
+        temp_storage_reset(audio_storage);
+        temp_storage_destroy(audio_storage);
+      temp_storage_init(Temp_Storage*, size_t) / temp_storage_deinit(Temp_Storage*) can be used instead of create/destroy
+      if you want to keep the Temp_Storage object in your own memory.
+
+    * Temp_Concurrent_Storage is an arena that many threads can allocate from at the same time (e.g. building command lists in parallel
+      that are consumed by one thread later). The bump pointer is advanced with an atomic fetch-add and new overflow pages are installed
+      with a compare-and-swap, so there are no locks.
+        temp_concurrent_init(&storage, capacity);
+        void* memory = temp_concurrent_alloc(&storage, size); // from any thread
+        temp_concurrent_reset(&storage);                     // only when no other thread is allocating
+        temp_concurrent_deinit(&storage);
 */
 
 #ifndef __TEMP_ALLOC__
 #define __TEMP_ALLOC__
 
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+
 #define DEFAULT_TEMP_ALLOC_CAPACITY_SIZE_MB 64
 #define DEFAULT_TEMP_ALLOC_CAPACITY_SIZE DEFAULT_TEMP_ALLOC_CAPACITY_SIZE_MB * 1024 * 1024
 #define ALIGMENT_BYTES sizeof(size_t)
+// 0 rounds up to ALIGMENT_BYTES too, so every allocation gets its own address (temp_free() relies on that).
+#define TEMP_ALIGN_SIZE(size) (((size) + ALIGMENT_BYTES - 1 + ((size) == 0)) & ~(size_t)(ALIGMENT_BYTES - 1))
+
+#if defined(__GNUC__) || defined(__clang__)
+    #define TEMP_LIKELY(x) __builtin_expect(!!(x), 1)
+    #define TEMP_NOINLINE __attribute__((noinline, cold))
+#elif defined(_MSC_VER)
+    #define TEMP_LIKELY(x) (x)
+    #define TEMP_NOINLINE __declspec(noinline)
+#else
+    #define TEMP_LIKELY(x) (x)
+    #define TEMP_NOINLINE
+#endif
+
+#ifdef TEMP_ALLOC_THREAD_LOCAL
+    #if defined(__cplusplus)
+        #define TEMP_THREAD_LOCAL thread_local
+    #elif defined(_MSC_VER)
+        #define TEMP_THREAD_LOCAL __declspec(thread)
+    #else
+        #define TEMP_THREAD_LOCAL _Thread_local
+    #endif
+#else
+    #define TEMP_THREAD_LOCAL
+#endif
+
+// 1 lets you turn the allocation info tracking on at runtime with temp_track_allocation_info(), 0 removes it completely.
+#ifndef TEMP_ALLOC_TRACK_INFO
+#define TEMP_ALLOC_TRACK_INFO 1
+#endif
+#define TEMP_TRACKING(storage) (TEMP_ALLOC_TRACK_INFO && (storage)->track_allocation_info)
+
+#define DEFAULT_TEMP_ALLOC_RESERVE_SIZE (sizeof(void*) == 8 ? (size_t)64 * 1024 * 1024 * 1024 : (size_t)512 * 1024 * 1024)
+
+// How much memory TEMP_BACKEND_VIRTUAL commits at once. Has to be a multiple of the OS page size.
+#ifndef TEMP_COMMIT_GRANULARITY
+#define TEMP_COMMIT_GRANULARITY (64 * 1024)
+#endif
+
+#define TEMP_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// options.max_page_size for TEMP_PAGE_GROWTH_CAPPED, if it's not set, is page_size times this.
+#ifndef TEMP_DEFAULT_MAX_PAGE_SIZE_FACTOR
+#define TEMP_DEFAULT_MAX_PAGE_SIZE_FACTOR 16
+#endif
+
+// How many page tails we keep around to allocate from, and how big they have to be.
+#ifndef TEMP_MAX_TAILS
+#define TEMP_MAX_TAILS 4
+#endif
+#ifndef TEMP_MIN_TAIL_SIZE
+#define TEMP_MIN_TAIL_SIZE 64
+#endif
+
+// Don't bother the OS for less than this on trim.
+#ifndef TEMP_TRIM_MIN_BYTES
+#define TEMP_TRIM_MIN_BYTES (1024 * 1024)
+#endif
+
+// Extra space added on top of the high water mark when the main block grows.
+#ifndef TEMP_ADAPTIVE_GROW_PERCENT
+#define TEMP_ADAPTIVE_GROW_PERCENT 25
+#endif
+// Every temp_reset() the high water mark moves 1/(2^TEMP_ADAPTIVE_DECAY_SHIFT) of the way down to the last frame usage.
+#ifndef TEMP_ADAPTIVE_DECAY_SHIFT
+#define TEMP_ADAPTIVE_DECAY_SHIFT 4
+#endif
+// The main block shrinks only when it is this many times bigger than the high water mark.
+#ifndef TEMP_ADAPTIVE_SHRINK_RATIO
+#define TEMP_ADAPTIVE_SHRINK_RATIO 2
+#endif
+
+// How many bytes of elements a Temp_List chunk holds by default (C++ only).
+#ifndef TEMP_LIST_CHUNK_BYTES
+#define TEMP_LIST_CHUNK_BYTES 4096
+#endif
+
+typedef enum
+{
+    TEMP_PAGES_NORMAL = 0,
+    TEMP_PAGES_TRANSPARENT_HUGE, // madvise(MADV_HUGEPAGE) succeeded, the kernel will back the block with huge pages when it can.
+    TEMP_PAGES_HUGE,             // Explicit huge pages (MAP_HUGETLB / MEM_LARGE_PAGES).
+} Temp_Page_Backing;
 
 typedef struct
 {
@@ -52,9 +307,22 @@ typedef struct
     size_t allocation_count;
     size_t average_allocation;
     size_t total_allocated_bytes;
-    size_t overflow_pages_allocated;
+    size_t overflow_pages_allocated; // Pages that were freshly allocated with alloc_proc.
+    size_t overflow_pages_reused;    // Pages that were taken from the retained pages instead.
+    size_t realloc_in_place_count;   // temp_realloc()/temp_resize_in_place() calls that just moved the end of the last allocation.
+    size_t realloc_copy_count;       // temp_realloc() calls that had to allocate and copy.
+    size_t peak_used_bytes;          // The most bytes in use at once in this frame.
+    size_t alignment_padding_bytes;  // Bytes skipped by temp_alloc_aligned() to align the allocations.
+    size_t large_allocation_count;   // Allocations that got their own block, see large_allocation_threshold.
+    size_t wasted_bytes;             // Bytes left at the end of the pages we moved away from.
+    size_t tail_reused_bytes;        // How much of wasted_bytes was given out again from the page tails.
+
+    // These are not reset.
+    Temp_Page_Backing main_block_backing;
+    size_t trimmed_bytes; // Total bytes given back to the OS by trim_memory.
 } Temp_Alloc_Info;
 
+// NOTE: The page header lives at the start of its own block, data points right after it (TEMP_PAGE_HEADER_SIZE).
 typedef struct
 {
     size_t current_size;
@@ -65,43 +333,275 @@ typedef struct
     void* next;
 } Overflow_Page;
 
+// The header is padded to a cache line so the page data starts at a nicely aligned address.
+#define TEMP_PAGE_HEADER_SIZE ((sizeof(Overflow_Page) + 63) & ~(size_t)63)
+
+typedef enum
+{
+    TEMP_BACKEND_HEAP = 0, // The main block is allocated with alloc_proc.
+    TEMP_BACKEND_VIRTUAL,  // The main block is reserved address space that gets committed on demand.
+} Temp_Backend;
+
+// Unused space at the end of a page we've moved away from.
+typedef struct
+{
+    void* at;
+    size_t size;
+} Temp_Tail;
+
+typedef enum
+{
+    TEMP_PAGE_GROWTH_FIXED = 0,
+    TEMP_PAGE_GROWTH_GEOMETRIC,
+    TEMP_PAGE_GROWTH_CAPPED,
+} Temp_Page_Growth;
+
+typedef struct
+{
+    Overflow_Page* page; // NULL means the main block.
+    Overflow_Page* large_page;
+    void* at;
+    size_t frame_used_bytes;
+    // The mark that was the innermost one before this one, restored by temp_set_mark().
+    Overflow_Page* previous_mark_page;
+    void* previous_mark_at;
+} Temp_Mark;
+
+typedef struct
+{
+    // 0 means DEFAULT_TEMP_ALLOC_CAPACITY_SIZE (or DEFAULT_TEMP_ALLOC_RESERVE_SIZE for TEMP_BACKEND_VIRTUAL).
+    size_t capacity;
+
+    Temp_Backend backend;
+
+    // How many bytes of overflow pages are kept after temp_reset() to be reused later. 0 means that all of them are freed.
+    size_t page_retention_budget;
+
+    // Resize the main block on temp_reset() to what the previous frames actually used. Ignored by TEMP_BACKEND_VIRTUAL.
+    bool adaptive_capacity;
+
+    // Back the main block and the overflow pages with 2 MB pages if the OS lets us.
+    bool huge_pages;
+
+    // Give memory beyond the decaying high water mark back to the OS on temp_reset().
+    bool trim_memory;
+
+    // How the overflow pages are sized.
+    Temp_Page_Growth page_growth;
+    size_t page_size;     // 0 means the main block capacity.
+    size_t max_page_size; // Only for TEMP_PAGE_GROWTH_CAPPED.
+
+    // Allocations of at least this many bytes get their own block. 0 means there is no threshold.
+    size_t large_allocation_threshold;
+} Temp_Options;
+
 typedef struct
 {
     void* (*alloc_proc)(size_t);
     void (*free_proc)(void*);
 
+    Temp_Options options;
+
     bool track_allocation_info;
     void* data;
+    // The page we're allocating from (or the main block) is [base, base + max_capacity) and at is its top.
+    // The bytes used in it are at - base.
+    void* base;
     void* at;
+    // Where the inline fast path has to stop. It's base while the fast path is off (tracking is on), see _update_end().
+    void* end;
     size_t max_capacity;
-    size_t current_size;
     size_t original_capacity;
+    // Size of the reserved address space for TEMP_BACKEND_VIRTUAL. original_capacity is how much of it is committed.
+    size_t reserved_capacity;
+    Temp_Page_Backing main_block_backing;
 
     Overflow_Page* overflow_page;
+    // The page we're allocating from. NULL means the main block.
+    // It's always the last page of the overflow_page list, so new pages are appended right after it.
+    Overflow_Page* current_page;
+    // The last allocation in the current page, it's the one temp_free() can give back. The inline path doesn't set it,
+    // so it's only trusted while at is still at last_allocation_end.
+    void* last_allocation;
+    void* last_allocation_end;
+
+    // Blocks of the large allocations, the newest one first.
+    Overflow_Page* large_pages;
+
+    // Position of the innermost live mark. Blocks below it can't grow in place, temp_set_mark() would cut them.
+    Overflow_Page* mark_page;
+    void* mark_at;
+
+    Temp_Tail tails[TEMP_MAX_TAILS];
+    size_t tail_count;
+
+    // Overflow pages that were kept after temp_reset().
+    Overflow_Page* retained_pages;
+    size_t retained_bytes;
+
+    // Bytes used in the main block and the overflow pages we've already left in this frame.
+    size_t frame_used_bytes;
+    // The most bytes used at once in this frame (temp_set_mark() can make the usage go down).
+    size_t frame_peak_bytes;
+    // Decaying maximum of the bytes used per frame.
+    size_t high_water_mark;
+    // Size of the next overflow page in this frame, see Temp_Page_Growth.
+    size_t next_page_size;
+    // How much of the main block was touched since the last trim.
+    size_t main_touched_size;
+    size_t trimmed_bytes;
 
     Temp_Alloc_Info info;
 } Temp_Storage;
 
+typedef struct
+{
+    void* (*alloc_proc)(size_t);
+    void (*free_proc)(void*);
+
+    size_t page_capacity;
+
+    // Pages are linked from the newest to the oldest one, the oldest one is the main page and it is kept after reset.
+    // current_size of a page is advanced atomically and can go past max_capacity when the page is full.
+    Overflow_Page* volatile current_page;
+    Overflow_Page* main_page;
+} Temp_Concurrent_Storage;
+
 void  temp_init(size_t given_capacity);
+void  temp_init_with_options(const Temp_Options* options);
 void  temp_set_alloc_proc(void* (*alloc_proc)(size_t));
 void  temp_set_free_proc(void (*free_proc)(void*));
 void  temp_track_allocation_info(bool track_status);
 void* temp_alloc(size_t size_to_alloc);
+void* temp_alloc_aligned(size_t size_to_alloc, size_t alignment);
 char* temp_printf(const char* format, ...);
 char* temp_copy_string(const char* c_string);
 char* temp_copy_string_size(const char* c_string, size_t size);
-void  temp_free(void*);
+void  temp_free(void* memory);
+void  temp_free_size(void* memory, size_t size);
 void* temp_realloc(void* old_memory, size_t old_size, size_t new_size);
+bool  temp_resize_in_place(void* memory, size_t old_size, size_t new_size);
 void  temp_reset();
 void  temp_deinit();
 
+Temp_Mark temp_get_mark();
+void      temp_set_mark(Temp_Mark mark);
+
 Temp_Alloc_Info temp_get_alloc_info();
 
-static Overflow_Page* _alloc_new_page(size_t size);
+Temp_Storage* temp_get_default_storage();
+
+Temp_Storage* temp_storage_create(size_t given_capacity);
+void  temp_storage_destroy(Temp_Storage* storage);
+void  temp_storage_init(Temp_Storage* storage, size_t given_capacity);
+void  temp_storage_init_with_options(Temp_Storage* storage, const Temp_Options* options);
+void  temp_storage_set_alloc_proc(Temp_Storage* storage, void* (*alloc_proc)(size_t));
+void  temp_storage_set_free_proc(Temp_Storage* storage, void (*free_proc)(void*));
+void  temp_storage_track_allocation_info(Temp_Storage* storage, bool track_status);
+void* temp_storage_alloc(Temp_Storage* storage, size_t size_to_alloc);
+void* temp_storage_alloc_aligned(Temp_Storage* storage, size_t size_to_alloc, size_t alignment);
+char* temp_storage_printf(Temp_Storage* storage, const char* format, ...);
+char* temp_storage_vprintf(Temp_Storage* storage, const char* format, va_list args);
+char* temp_storage_copy_string(Temp_Storage* storage, const char* c_string);
+char* temp_storage_copy_string_size(Temp_Storage* storage, const char* c_string, size_t size);
+void  temp_storage_free(Temp_Storage* storage, void* memory);
+void  temp_storage_free_size(Temp_Storage* storage, void* memory, size_t size);
+void* temp_storage_realloc(Temp_Storage* storage, void* old_memory, size_t old_size, size_t new_size);
+bool  temp_storage_resize_in_place(Temp_Storage* storage, void* memory, size_t old_size, size_t new_size);
+void  temp_storage_reset(Temp_Storage* storage);
+void  temp_storage_deinit(Temp_Storage* storage);
+
+Temp_Mark temp_storage_get_mark(Temp_Storage* storage);
+void      temp_storage_set_mark(Temp_Storage* storage, Temp_Mark mark);
+
+Temp_Alloc_Info temp_storage_get_alloc_info(Temp_Storage* storage);
+
+void  temp_concurrent_init(Temp_Concurrent_Storage* storage, size_t given_capacity);
+void* temp_concurrent_alloc(Temp_Concurrent_Storage* storage, size_t size_to_alloc);
+void  temp_concurrent_reset(Temp_Concurrent_Storage* storage);
+void  temp_concurrent_deinit(Temp_Concurrent_Storage* storage);
+
+static Overflow_Page* _alloc_new_page(Temp_Storage* storage, size_t size);
+
+// NOTE: Don't touch it directly, it's only here for the inline procedures below.
+extern TEMP_THREAD_LOCAL Temp_Storage g_temp_storage;
+
+// The inline fast path: if the allocation fits in the current page, just bump the pointer. It only reads at and end and only
+// writes at, everything else (tracking, temp_free() info, new pages) is up to the out of line temp_alloc().
+// With tracking on end is moved down to base, so this is always false.
+static inline bool _temp_can_bump(const Temp_Storage* storage, size_t size)
+{
+    return (char*)storage->end - (char*)storage->at > (ptrdiff_t)size;
+}
+
+static inline void* _temp_bump(Temp_Storage* storage, size_t size)
+{
+    void* result = storage->at;
+    storage->at = (char*)result + size;
+    return result;
+}
+
+// Bytes we have to skip at the top so the next allocation is aligned. alignment has to be a power of two.
+static inline size_t _temp_alignment_padding(const void* at, size_t alignment)
+{
+    return (size_t)(0 - (uintptr_t)at) & (alignment - 1);
+}
+
+static inline void* temp_storage_alloc_inline(Temp_Storage* storage, size_t size_to_alloc)
+{
+    const size_t size = TEMP_ALIGN_SIZE(size_to_alloc);
+    if (TEMP_LIKELY(_temp_can_bump(storage, size)))
+        return _temp_bump(storage, size);
+    return temp_storage_alloc(storage, size_to_alloc);
+}
+
+static inline void* temp_alloc_inline(size_t size_to_alloc)
+{
+    const size_t size = TEMP_ALIGN_SIZE(size_to_alloc);
+    if (TEMP_LIKELY(_temp_can_bump(&g_temp_storage, size)))
+        return _temp_bump(&g_temp_storage, size);
+    return temp_alloc(size_to_alloc);
+}
+
+// With a constant alignment the padding is just an add and a mask.
+static inline void* temp_storage_alloc_aligned_inline(Temp_Storage* storage, size_t size_to_alloc, size_t alignment)
+{
+    const size_t size = TEMP_ALIGN_SIZE(size_to_alloc);
+    const size_t padding = _temp_alignment_padding(storage->at, alignment);
+    if (TEMP_LIKELY(_temp_can_bump(storage, size + padding)))
+    {
+        void* result = (char*)storage->at + padding;
+        storage->at = (char*)result + size;
+        return result;
+    }
+    return temp_storage_alloc_aligned(storage, size_to_alloc, alignment);
+}
+
+static inline void* temp_alloc_aligned_inline(size_t size_to_alloc, size_t alignment)
+{
+    const size_t size = TEMP_ALIGN_SIZE(size_to_alloc);
+    const size_t padding = _temp_alignment_padding(g_temp_storage.at, alignment);
+    if (TEMP_LIKELY(_temp_can_bump(&g_temp_storage, size + padding)))
+    {
+        void* result = (char*)g_temp_storage.at + padding;
+        g_temp_storage.at = (char*)result + size;
+        return result;
+    }
+    return temp_alloc_aligned(size_to_alloc, alignment);
+}
 
 #ifdef __cplusplus
+#include <cassert>
+#include <cstdarg>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 template<class type>
 struct temp_alloc_stl
@@ -114,234 +614,2063 @@ struct temp_alloc_stl
     typedef std::size_t       size_type;
     typedef std::ptrdiff_t    difference_type;
 
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type is_always_equal;
+
     template <class type_other> struct rebind { typedef temp_alloc_stl<type_other> other; };
     temp_alloc_stl() noexcept = default;
     temp_alloc_stl(const temp_alloc_stl&) noexcept = default;
     template<class type_other> temp_alloc_stl(const temp_alloc_stl<type_other>&) noexcept { }
 
     temp_alloc_stl  select_on_container_copy_construction() const { return *this; }
-    void            deallocate(type* p, size_type) { temp_free(p); }
+    void            deallocate(type* p, size_type count) { temp_free_size(p, count * sizeof(value_type)); }
 
-    pointer allocate(size_t count, const void* = 0) { return static_cast<pointer>(temp_alloc(count * sizeof(value_type))); }
+    pointer allocate(size_t count, const void* = 0)
+    {
+        if (alignof(value_type) > ALIGMENT_BYTES)
+            return static_cast<pointer>(temp_alloc_aligned(count * sizeof(value_type), alignof(value_type)));
+        return static_cast<pointer>(temp_alloc(count * sizeof(value_type)));
+    }
 
     size_type     max_size() const noexcept { return (PTRDIFF_MAX / sizeof(value_type)); }
     pointer       address(reference x) const { return &x; }
     const_pointer address(const_reference x) const { return &x; }
 };
 
-#endif // __cplusplus
+template<class type_a, class type_b>
+bool operator==(const temp_alloc_stl<type_a>&, const temp_alloc_stl<type_b>&) noexcept { return true; }
+template<class type_a, class type_b>
+bool operator!=(const temp_alloc_stl<type_a>&, const temp_alloc_stl<type_b>&) noexcept { return false; }
 
-#ifdef TEMP_ALLOC_IMPLEMENTATION
-#include <stdio.h>
-#include <assert.h>
-#include <string.h>
-#include <malloc.h>
-#include <stdbool.h>
-#include <stdint.h>
-#include <stdarg.h>
+// Same as temp_alloc_stl, but it allocates from the storage it was constructed with instead of the default one.
+template<class type>
+struct temp_storage_alloc_stl
+{
+    typedef type value_type;
+    typedef type* pointer;
+    typedef value_type& reference;
+    typedef value_type const& const_reference;
+    typedef value_type const* const_pointer;
+    typedef std::size_t       size_type;
+    typedef std::ptrdiff_t    difference_type;
+
+    // The storage moves along with the memory, so a move assignment just steals the buffer.
+    typedef std::true_type  propagate_on_container_copy_assignment;
+    typedef std::true_type  propagate_on_container_move_assignment;
+    typedef std::true_type  propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    Temp_Storage* storage;
+
+    template <class type_other> struct rebind { typedef temp_storage_alloc_stl<type_other> other; };
+    temp_storage_alloc_stl() noexcept : storage(temp_get_default_storage()) { }
+    temp_storage_alloc_stl(Temp_Storage* storage) noexcept : storage(storage) { }
+    temp_storage_alloc_stl(const temp_storage_alloc_stl&) noexcept = default;
+    template<class type_other> temp_storage_alloc_stl(const temp_storage_alloc_stl<type_other>& other) noexcept : storage(other.storage) { }
+
+    temp_storage_alloc_stl select_on_container_copy_construction() const { return *this; }
+    void                   deallocate(type* p, size_type count) { temp_storage_free_size(storage, p, count * sizeof(value_type)); }
 
-static Temp_Storage g_temp_storage;
+    pointer allocate(size_t count, const void* = 0)
+    {
+        if (alignof(value_type) > ALIGMENT_BYTES)
+            return static_cast<pointer>(temp_storage_alloc_aligned(storage, count * sizeof(value_type), alignof(value_type)));
+        return static_cast<pointer>(temp_storage_alloc(storage, count * sizeof(value_type)));
+    }
+
+#if defined(__cpp_lib_allocate_at_least)
+    // Every allocation is rounded up to ALIGMENT_BYTES anyway, so we tell the container about the elements that fit in there.
+    std::allocation_result<pointer, size_type> allocate_at_least(size_type count)
+    {
+        const size_type usable_count = TEMP_ALIGN_SIZE(count * sizeof(value_type)) / sizeof(value_type);
+        return { allocate(usable_count), usable_count };
+    }
+#endif
+
+    size_type     max_size() const noexcept { return (PTRDIFF_MAX / sizeof(value_type)); }
+    pointer       address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+};
 
-static Overflow_Page* _alloc_new_page(size_t size)
+template<class type_a, class type_b>
+bool operator==(const temp_storage_alloc_stl<type_a>& a, const temp_storage_alloc_stl<type_b>& b) noexcept { return a.storage == b.storage; }
+template<class type_a, class type_b>
+bool operator!=(const temp_storage_alloc_stl<type_a>& a, const temp_storage_alloc_stl<type_b>& b) noexcept { return a.storage != b.storage; }
+
+struct Temp_Scope
 {
-    Overflow_Page new_page = { 0 };
-    g_temp_storage.info.overflow_pages_allocated += 1;
+    Temp_Storage* storage;
+    Temp_Mark     mark;
 
-    // if we've got a very large allocation, then allocate a block with this size + max_capacity
-    if (size > g_temp_storage.max_capacity)
-        new_page.max_capacity = size + g_temp_storage.max_capacity;
-    else
-        new_page.max_capacity = g_temp_storage.max_capacity;
+    Temp_Scope() : Temp_Scope(temp_get_default_storage()) { }
+    explicit Temp_Scope(Temp_Storage* storage) : storage(storage), mark(temp_storage_get_mark(storage)) { }
+    ~Temp_Scope() { temp_storage_set_mark(storage, mark); }
 
-    new_page.data = g_temp_storage.alloc_proc(new_page.max_capacity);
-    new_page.at = new_page.data;
-    new_page.next = NULL;
+    Temp_Scope(const Temp_Scope&) = delete;
+    Temp_Scope& operator=(const Temp_Scope&) = delete;
+};
 
-    if (g_temp_storage.overflow_page == NULL)
+template<class type>
+struct Temp_Array
+{
+    Temp_Storage* storage;
+    type*         data;
+    size_t        count;
+    size_t        capacity;
+
+    Temp_Array() : Temp_Array(temp_get_default_storage()) { }
+    explicit Temp_Array(Temp_Storage* storage) : storage(storage), data(nullptr), count(0), capacity(0) { }
+    Temp_Array(Temp_Array&& other) noexcept : storage(other.storage), data(other.data), count(other.count), capacity(other.capacity)
     {
-        g_temp_storage.overflow_page = (Overflow_Page*)g_temp_storage.alloc_proc(sizeof(Overflow_Page));
-        assert(g_temp_storage.overflow_page != NULL);
-        *g_temp_storage.overflow_page = new_page;
-        return g_temp_storage.overflow_page;
+        other.data = nullptr;
+        other.count = 0;
+        other.capacity = 0;
     }
-    else
+    ~Temp_Array()
     {
-        Overflow_Page* current_page = g_temp_storage.overflow_page;
+        clear();
+        temp_storage_free_size(storage, data, capacity * sizeof(type));
+    }
 
-        while (current_page->next != NULL)
-            current_page = (Overflow_Page*)current_page->next;
+    Temp_Array(const Temp_Array&) = delete;
+    Temp_Array& operator=(const Temp_Array&) = delete;
 
-        current_page->next = (Overflow_Page*)g_temp_storage.alloc_proc(sizeof(Overflow_Page));
-        assert(current_page->next != NULL);
-        current_page = (Overflow_Page*)current_page->next;
-        *current_page = new_page;
-        return current_page;
+    void reserve(size_t new_capacity)
+    {
+        if (new_capacity <= capacity)
+            return;
+
+        // If nothing was allocated after us, we just move the end of the buffer.
+        if (temp_storage_resize_in_place(storage, data, capacity * sizeof(type), new_capacity * sizeof(type)))
+        {
+            capacity = new_capacity;
+            return;
+        }
+
+        type* new_data;
+        if (alignof(type) > ALIGMENT_BYTES)
+            new_data = static_cast<type*>(temp_storage_alloc_aligned(storage, new_capacity * sizeof(type), alignof(type)));
+        else
+            new_data = static_cast<type*>(temp_storage_alloc(storage, new_capacity * sizeof(type)));
+
+        for (size_t i = 0; i < count; i++)
+        {
+            new (new_data + i) type(std::move(data[i]));
+            data[i].~type();
+        }
+
+        // The old buffer stays where it is until temp_reset(), the new one is the last allocation now.
+        data = new_data;
+        capacity = new_capacity;
     }
 
-    assert(false);
-    return NULL;
-}
+    // Gives the unused capacity back, if the array is still the last allocation.
+    void shrink_to_fit()
+    {
+        if (count < capacity && temp_storage_resize_in_place(storage, data, capacity * sizeof(type), count * sizeof(type)))
+            capacity = count;
+    }
 
-void temp_init(size_t given_capacity)
-{
-    size_t capacity = 0;
-    if (given_capacity == 0)
-        capacity = DEFAULT_TEMP_ALLOC_CAPACITY_SIZE;
+    template<class... types>
+    type& emplace_back(types&&... args)
+    {
+        if (count == capacity)
+            reserve(capacity != 0 ? capacity * 2 : 8);
+        type* result = new (data + count) type(std::forward<types>(args)...);
+        count += 1;
+        return *result;
+    }
 
-    // Default alloc proc is malloc.
-    temp_set_alloc_proc(&malloc);
-    temp_set_free_proc(&free);
+    void push_back(const type& value) { emplace_back(value); }
+    void push_back(type&& value)      { emplace_back(std::move(value)); }
 
-    g_temp_storage.data = g_temp_storage.alloc_proc(capacity);
-    g_temp_storage.at = g_temp_storage.data;
+    void pop_back()
+    {
+        assert(count > 0);
+        count -= 1;
+        data[count].~type();
+    }
 
-    assert(g_temp_storage.data != NULL);
+    void resize(size_t new_count)
+    {
+        reserve(new_count);
+        while (count > new_count)
+            pop_back();
+        while (count < new_count)
+            emplace_back();
+    }
 
-    g_temp_storage.max_capacity = capacity;
-    g_temp_storage.current_size = 0;
-    g_temp_storage.overflow_page = NULL;
-    g_temp_storage.original_capacity = capacity;
-    g_temp_storage.track_allocation_info = false;
-}
+    void clear()
+    {
+        while (count > 0)
+            pop_back();
+    }
 
-void temp_set_alloc_proc(void* (*alloc_proc)(size_t))
-{
-    g_temp_storage.alloc_proc = alloc_proc;
-}
-void temp_set_free_proc(void (*free_proc)(void*))
-{
-    g_temp_storage.free_proc = free_proc;
-}
+    type&       operator[](size_t index)       { assert(index < count); return data[index]; }
+    const type& operator[](size_t index) const { assert(index < count); return data[index]; }
+    type&       back()       { assert(count > 0); return data[count - 1]; }
+    const type& back() const { assert(count > 0); return data[count - 1]; }
 
-void temp_track_allocation_info(bool track_status)
-{
-    g_temp_storage.track_allocation_info = track_status;
-}
+    type*       begin()       { return data; }
+    type*       end()         { return data + count; }
+    const type* begin() const { return data; }
+    const type* end()   const { return data + count; }
 
-void* temp_alloc(size_t size_to_alloc)
+    size_t size()  const { return count; }
+    bool   empty() const { return count == 0; }
+};
+
+template<class type, size_t chunk_capacity = (TEMP_LIST_CHUNK_BYTES / sizeof(type) > 0 ? TEMP_LIST_CHUNK_BYTES / sizeof(type) : 1)>
+struct Temp_List
 {
-    //const size_t size = (size_to_alloc + ALIGMENT_BYTES - 1) & ~ALIGMENT_BYTES - 1;
-    const size_t size = size_to_alloc + (ALIGMENT_BYTES - (size_to_alloc % ALIGMENT_BYTES));
+    struct Chunk
+    {
+        Chunk* next;
+        size_t count;
+        alignas(type) unsigned char memory[chunk_capacity * sizeof(type)];
+
+        type*       items()       { return reinterpret_cast<type*>(memory); }
+        const type* items() const { return reinterpret_cast<const type*>(memory); }
+    };
+
+    template<class value_type, class chunk_type>
+    struct Iterator
+    {
+        chunk_type* chunk;
+        size_t      index;
+
+        value_type& operator*()  const { return chunk->items()[index]; }
+        value_type* operator->() const { return chunk->items() + index; }
+        bool operator==(const Iterator& other) const { return chunk == other.chunk && index == other.index; }
+        bool operator!=(const Iterator& other) const { return chunk != other.chunk || index != other.index; }
+
+        Iterator& operator++()
+        {
+            index += 1;
+            if (index == chunk->count)
+            {
+                chunk = chunk->next;
+                index = 0;
+            }
+            return *this;
+        }
+    };
+
+    typedef Iterator<type, Chunk>             iterator;
+    typedef Iterator<const type, const Chunk> const_iterator;
+
+    Temp_Storage* storage;
+    Chunk*        first;
+    Chunk*        last;
+    size_t        count;
+
+    Temp_List() : Temp_List(temp_get_default_storage()) { }
+    explicit Temp_List(Temp_Storage* storage) : storage(storage), first(nullptr), last(nullptr), count(0) { }
+    Temp_List(Temp_List&& other) noexcept : storage(other.storage), first(other.first), last(other.last), count(other.count)
+    {
+        other.first = nullptr;
+        other.last = nullptr;
+        other.count = 0;
+    }
+    ~Temp_List() { clear(); }
 
-    if (g_temp_storage.track_allocation_info)
+    Temp_List(const Temp_List&) = delete;
+    Temp_List& operator=(const Temp_List&) = delete;
+
+    // The elements never move, so the returned reference stays valid until the list is cleared.
+    template<class... types>
+    type& emplace_back(types&&... args)
     {
-        g_temp_storage.info.allocation_count += 1;
-        if (size > g_temp_storage.info.max_allocation)
-            g_temp_storage.info.max_allocation = size_to_alloc;
+        if (last == nullptr || last->count == chunk_capacity)
+        {
+            Chunk* chunk;
+            if (alignof(Chunk) > ALIGMENT_BYTES)
+                chunk = static_cast<Chunk*>(temp_storage_alloc_aligned(storage, sizeof(Chunk), alignof(Chunk)));
+            else
+                chunk = static_cast<Chunk*>(temp_storage_alloc(storage, sizeof(Chunk)));
+
+            chunk->next = nullptr;
+            chunk->count = 0;
+
+            if (last != nullptr)
+                last->next = chunk;
+            else
+                first = chunk;
+            last = chunk;
+        }
 
-        g_temp_storage.info.total_allocated_bytes += size;
+        type* result = new (last->items() + last->count) type(std::forward<types>(args)...);
+        last->count += 1;
+        count += 1;
+        return *result;
     }
 
-    if ((g_temp_storage.max_capacity - g_temp_storage.current_size) <= size)
+    type& push_back(const type& value) { return emplace_back(value); }
+    type& push_back(type&& value)      { return emplace_back(std::move(value)); }
+
+    // The chunks stay in the storage until it's reset.
+    void clear()
     {
-        Overflow_Page* page = _alloc_new_page(size);
+        if (!std::is_trivially_destructible<type>::value)
+        {
+            for (Chunk* chunk = first; chunk != nullptr; chunk = chunk->next)
+                for (size_t i = 0; i < chunk->count; i++)
+                    chunk->items()[i].~type();
+        }
 
-        g_temp_storage.at = page->data;
-        g_temp_storage.max_capacity = page->max_capacity;
-        g_temp_storage.current_size = 0;
+        first = nullptr;
+        last = nullptr;
+        count = 0;
     }
 
-    void* result = g_temp_storage.at;
-    assert(result != NULL);
+    // Copies all the elements into one exactly sized array allocated from the storage.
+    type* flatten() const
+    {
+        if (count == 0)
+            return nullptr;
 
-    g_temp_storage.at = (char*)g_temp_storage.at + size;
+        type* result;
+        if (alignof(type) > ALIGMENT_BYTES)
+            result = static_cast<type*>(temp_storage_alloc_aligned(storage, count * sizeof(type), alignof(type)));
+        else
+            result = static_cast<type*>(temp_storage_alloc(storage, count * sizeof(type)));
 
-    g_temp_storage.current_size += size;
-    return result;
-}
+        type* at = result;
+        for (const Chunk* chunk = first; chunk != nullptr; chunk = chunk->next)
+        {
+            if (std::is_trivially_copyable<type>::value)
+            {
+                memcpy(static_cast<void*>(at), chunk->items(), chunk->count * sizeof(type));
+                at += chunk->count;
+            }
+            else
+            {
+                for (size_t i = 0; i < chunk->count; i++)
+                    new (at++) type(chunk->items()[i]);
+            }
+        }
+        return result;
+    }
 
-char* temp_printf(const char* format, ...)
-{
-    va_list args;
-    va_start(args, format);
-    size_t buffer_size = vsnprintf(NULL, 0, format, args);
-    va_end(args);
+    iterator       begin()       { return iterator{ first, 0 }; }
+    iterator       end()         { return iterator{ nullptr, 0 }; }
+    const_iterator begin() const { return const_iterator{ first, 0 }; }
+    const_iterator end()   const { return const_iterator{ nullptr, 0 }; }
 
-    char* buf = (char*)temp_alloc(buffer_size);
+    size_t size()  const { return count; }
+    bool   empty() const { return count == 0; }
+};
 
-    va_start(args, format);
-    vsnprintf(buf, buffer_size+1, format, args);
-    va_end(args);
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define TEMP_HASH_SSE2 1
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+#endif
 
-    buf[buffer_size] = 0;
-    return buf;
-}
+// The hash tables look at this many control bytes at once.
+#define TEMP_HASH_GROUP_SIZE 16
+#define TEMP_HASH_EMPTY ((int8_t)-128)
 
-char* temp_copy_string(const char* c_string)
+// Returns a bit for every control byte in the group that is equal to value. The groups are always 16 byte aligned.
+static inline unsigned _temp_hash_group_match(const int8_t* group, int8_t value)
 {
-    const size_t c_string_size = strlen(c_string);
-    char* new_string = (char*)temp_alloc(c_string_size + 1);
-    new_string = (char*)memcpy(new_string, c_string, c_string_size);
-    new_string[c_string_size] = 0;
-    return new_string;
+#ifdef TEMP_HASH_SSE2
+    const __m128i control = _mm_load_si128((const __m128i*)group);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(value)));
+#else
+    unsigned mask = 0;
+    for (unsigned i = 0; i < TEMP_HASH_GROUP_SIZE; i++)
+        mask |= (unsigned)(group[i] == value) << i;
+    return mask;
+#endif
 }
 
-char* temp_copy_string_size(const char* c_string, size_t size)
+static inline unsigned _temp_lowest_bit(unsigned mask)
 {
-    char* new_string = (char*)temp_alloc(size + 1);
-    new_string = (char*)memcpy(new_string, c_string, size + 1);
-    new_string[size] = 0;
-    return new_string;
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (unsigned)index;
+#else
+    return (unsigned)__builtin_ctz(mask);
+#endif
 }
 
-void temp_free(void*) { /* Do nothing. */ }
-
-void* temp_realloc(void* old_memory, size_t old_size, size_t new_size)
+// std::hash is often just the identity for integers, so we spread the bits before using them.
+static inline size_t _temp_hash_mix(size_t hash)
 {
-    void* memory = temp_alloc(new_size);
-    return memcpy(memory, old_memory, old_size);
+    const uint64_t x = (uint64_t)hash * 0x9E3779B97F4A7C15ull;
+    return (size_t)(x ^ (x >> 32));
 }
 
-Temp_Alloc_Info temp_get_alloc_info()
+template<class key_type, class value_type>
+struct Temp_Hash_Map_Entry
 {
-    Temp_Alloc_Info info = { 0 };
-    if (g_temp_storage.track_allocation_info)
+    key_type   key;
+    value_type value;
+};
+
+template<class key_type>
+const key_type& _temp_hash_key(const key_type& entry) { return entry; }
+template<class key_type, class value_type>
+const key_type& _temp_hash_key(const Temp_Hash_Map_Entry<key_type, value_type>& entry) { return entry.key; }
+
+// Open addressing table shared by Temp_Hash_Map and Temp_Hash_Set. Every slot has a control byte that is either
+// TEMP_HASH_EMPTY or 7 bits of the hash of its key, and we probe TEMP_HASH_GROUP_SIZE of them at once.
+// There is no remove, the tables are meant to be filled, queried and then thrown away with the frame.
+template<class entry_type, class key_type, class hasher>
+struct _Temp_Hash_Table
+{
+    template<class value_type>
+    struct Iterator
     {
-        info = g_temp_storage.info;
-        info.average_allocation = info.total_allocated_bytes / info.allocation_count;
+        const int8_t* control;
+        value_type*   entries;
+        size_t        index;
+        size_t        capacity;
+
+        value_type& operator*()  const { return entries[index]; }
+        value_type* operator->() const { return entries + index; }
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+        Iterator& operator++()
+        {
+            index += 1;
+            while (index < capacity && control[index] == TEMP_HASH_EMPTY)
+                index += 1;
+            return *this;
+        }
+    };
+
+    typedef Iterator<entry_type>       iterator;
+    typedef Iterator<const entry_type> const_iterator;
+
+    Temp_Storage* storage;
+    int8_t*       control;
+    entry_type*   entries;
+    size_t        capacity; // 0 or a power of two, at least TEMP_HASH_GROUP_SIZE.
+    size_t        count;
+
+    explicit _Temp_Hash_Table(Temp_Storage* storage) : storage(storage), control(nullptr), entries(nullptr), capacity(0), count(0) { }
+    _Temp_Hash_Table(_Temp_Hash_Table&& other) noexcept
+        : storage(other.storage), control(other.control), entries(other.entries), capacity(other.capacity), count(other.count)
+    {
+        other.control = nullptr;
+        other.entries = nullptr;
+        other.capacity = 0;
+        other.count = 0;
     }
-    return info;
-}
+    ~_Temp_Hash_Table() { _destroy_entries(); }
 
-void temp_reset()
-{
-    // Free allocated pages.
-    Overflow_Page* current_page = g_temp_storage.overflow_page;
-    Overflow_Page* prev_page = NULL;
+    _Temp_Hash_Table(const _Temp_Hash_Table&) = delete;
+    _Temp_Hash_Table& operator=(const _Temp_Hash_Table&) = delete;
 
-    if (current_page != NULL)
+    // Call this first if you know how many there will be, so the table never has to grow.
+    void reserve(size_t needed_count)
     {
-        while (current_page->next != NULL)
-        {
-            g_temp_storage.free_proc(prev_page);
-            g_temp_storage.free_proc(current_page->data);
+        if (needed_count * 8 <= capacity * 7)
+            return;
+
+        size_t new_capacity = TEMP_HASH_GROUP_SIZE;
+        while (new_capacity * 7 < needed_count * 8)
+            new_capacity *= 2;
+
+        _rehash(new_capacity);
+    }
 
-            prev_page = current_page;
-            current_page = (Overflow_Page*)current_page->next;
+    entry_type* find(const key_type& key)
+    {
+        return const_cast<entry_type*>(static_cast<const _Temp_Hash_Table*>(this)->find(key));
+    }
+
+    const entry_type* find(const key_type& key) const
+    {
+        if (count == 0)
+            return nullptr;
+
+        const size_t hash = _temp_hash_mix(hasher()(key));
+        const int8_t tag = (int8_t)(hash & 0x7F);
+        const size_t mask = capacity - 1;
+
+        size_t group = (hash >> 7) & mask & ~(size_t)(TEMP_HASH_GROUP_SIZE - 1);
+        for (size_t step = TEMP_HASH_GROUP_SIZE;; step += TEMP_HASH_GROUP_SIZE)
+        {
+            for (unsigned match = _temp_hash_group_match(control + group, tag); match != 0; match &= match - 1)
+            {
+                const size_t index = group + _temp_lowest_bit(match);
+                if (_temp_hash_key(entries[index]) == key)
+                    return entries + index;
+            }
+
+            // Nothing is ever removed, so an empty slot means the key would have been here.
+            if (_temp_hash_group_match(control + group, TEMP_HASH_EMPTY) != 0)
+                return nullptr;
+
+            group = (group + step) & mask;
         }
-        g_temp_storage.free_proc(prev_page);
-        g_temp_storage.free_proc(current_page->data);
     }
 
-    // Reset the storage.
-    g_temp_storage.overflow_page = NULL;
-    g_temp_storage.at = g_temp_storage.data;
-    g_temp_storage.current_size = 0;
-    g_temp_storage.max_capacity = g_temp_storage.original_capacity;
+    bool contains(const key_type& key) const { return find(key) != nullptr; }
 
-    // Reset allocation info.
-    if (g_temp_storage.track_allocation_info)
-        g_temp_storage.info = { 0 };
-}
+    void clear()
+    {
+        _destroy_entries();
+        if (control != nullptr)
+            memset(control, TEMP_HASH_EMPTY, capacity);
+        count = 0;
+    }
 
-void temp_deinit()
-{
-    g_temp_storage.free_proc(g_temp_storage.data);
+    iterator begin()
+    {
+        iterator result = { control, entries, 0, capacity };
+        if (capacity != 0 && control[0] == TEMP_HASH_EMPTY)
+            ++result;
+        return result;
+    }
+    iterator end() { return iterator{ control, entries, capacity, capacity }; }
+
+    const_iterator begin() const
+    {
+        const_iterator result = { control, entries, 0, capacity };
+        if (capacity != 0 && control[0] == TEMP_HASH_EMPTY)
+            ++result;
+        return result;
+    }
+    const_iterator end() const { return const_iterator{ control, entries, capacity, capacity }; }
+
+    size_t size()  const { return count; }
+    bool   empty() const { return count == 0; }
+
+protected:
+    // Returns the slot of the key. If it wasn't there, *inserted is set and the caller has to construct the entry in it.
+    entry_type* _insert(const key_type& key, bool* inserted)
+    {
+        if ((count + 1) * 8 > capacity * 7)
+            reserve(count + 1);
+
+        const size_t hash = _temp_hash_mix(hasher()(key));
+        const int8_t tag = (int8_t)(hash & 0x7F);
+        const size_t mask = capacity - 1;
+
+        size_t group = (hash >> 7) & mask & ~(size_t)(TEMP_HASH_GROUP_SIZE - 1);
+        for (size_t step = TEMP_HASH_GROUP_SIZE;; step += TEMP_HASH_GROUP_SIZE)
+        {
+            for (unsigned match = _temp_hash_group_match(control + group, tag); match != 0; match &= match - 1)
+            {
+                const size_t index = group + _temp_lowest_bit(match);
+                if (_temp_hash_key(entries[index]) == key)
+                {
+                    *inserted = false;
+                    return entries + index;
+                }
+            }
+
+            const unsigned empty = _temp_hash_group_match(control + group, TEMP_HASH_EMPTY);
+            if (empty != 0)
+            {
+                const size_t index = group + _temp_lowest_bit(empty);
+                control[index] = tag;
+                count += 1;
+                *inserted = true;
+                return entries + index;
+            }
+
+            group = (group + step) & mask;
+        }
+    }
+
+private:
+    void _destroy_entries()
+    {
+        if (!std::is_trivially_destructible<entry_type>::value)
+        {
+            for (size_t i = 0; i < capacity; i++)
+                if (control[i] != TEMP_HASH_EMPTY)
+                    entries[i].~entry_type();
+        }
+    }
 
-    g_temp_storage.data = NULL;
-    g_temp_storage.at = NULL;
-    g_temp_storage.current_size = 0;
-    g_temp_storage.max_capacity = 0;
+    // The control bytes and the entries are one allocation. The old one stays in the storage until it's reset.
+    void _rehash(size_t new_capacity)
+    {
+        const size_t alignment = alignof(entry_type) > TEMP_HASH_GROUP_SIZE ? alignof(entry_type) : TEMP_HASH_GROUP_SIZE;
+        const size_t control_size = (new_capacity + alignment - 1) & ~(alignment - 1);
+
+        char* memory = static_cast<char*>(temp_storage_alloc_aligned(storage, control_size + new_capacity * sizeof(entry_type), alignment));
+        int8_t*     new_control = reinterpret_cast<int8_t*>(memory);
+        entry_type* new_entries = reinterpret_cast<entry_type*>(memory + control_size);
+        memset(new_control, TEMP_HASH_EMPTY, new_capacity);
+
+        const size_t mask = new_capacity - 1;
+        for (size_t i = 0; i < capacity; i++)
+        {
+            if (control[i] == TEMP_HASH_EMPTY)
+                continue;
+
+            const size_t hash = _temp_hash_mix(hasher()(_temp_hash_key(entries[i])));
+            size_t group = (hash >> 7) & mask & ~(size_t)(TEMP_HASH_GROUP_SIZE - 1);
+            unsigned empty = _temp_hash_group_match(new_control + group, TEMP_HASH_EMPTY);
+            for (size_t step = TEMP_HASH_GROUP_SIZE; empty == 0; step += TEMP_HASH_GROUP_SIZE)
+            {
+                group = (group + step) & mask;
+                empty = _temp_hash_group_match(new_control + group, TEMP_HASH_EMPTY);
+            }
+
+            const size_t index = group + _temp_lowest_bit(empty);
+            new_control[index] = control[i];
+            new (new_entries + index) entry_type(std::move(entries[i]));
+            entries[i].~entry_type();
+        }
+
+        control = new_control;
+        entries = new_entries;
+        capacity = new_capacity;
+    }
+};
+
+template<class key_type, class value_type, class hasher = std::hash<key_type>>
+struct Temp_Hash_Map : _Temp_Hash_Table<Temp_Hash_Map_Entry<key_type, value_type>, key_type, hasher>
+{
+    typedef Temp_Hash_Map_Entry<key_type, value_type> entry_type;
+    typedef _Temp_Hash_Table<entry_type, key_type, hasher> table_type;
+
+    Temp_Hash_Map() : table_type(temp_get_default_storage()) { }
+    explicit Temp_Hash_Map(Temp_Storage* storage) : table_type(storage) { }
+
+    // Returns false if the key was already there, the old value is kept then.
+    bool insert(const key_type& key, const value_type& value)
+    {
+        bool inserted;
+        entry_type* entry = this->_insert(key, &inserted);
+        if (inserted)
+            new (entry) entry_type{ key, value };
+        return inserted;
+    }
+
+    value_type& operator[](const key_type& key)
+    {
+        bool inserted;
+        entry_type* entry = this->_insert(key, &inserted);
+        if (inserted)
+            new (entry) entry_type{ key, value_type() };
+        return entry->value;
+    }
+
+    value_type* get(const key_type& key)
+    {
+        entry_type* entry = this->find(key);
+        return entry != nullptr ? &entry->value : nullptr;
+    }
+
+    const value_type* get(const key_type& key) const
+    {
+        const entry_type* entry = this->find(key);
+        return entry != nullptr ? &entry->value : nullptr;
+    }
+};
+
+template<class key_type, class hasher = std::hash<key_type>>
+struct Temp_Hash_Set : _Temp_Hash_Table<key_type, key_type, hasher>
+{
+    typedef _Temp_Hash_Table<key_type, key_type, hasher> table_type;
+
+    Temp_Hash_Set() : table_type(temp_get_default_storage()) { }
+    explicit Temp_Hash_Set(Temp_Storage* storage) : table_type(storage) { }
+
+    // Returns false if the key was already there.
+    bool insert(const key_type& key)
+    {
+        bool inserted;
+        key_type* entry = this->_insert(key, &inserted);
+        if (inserted)
+            new (entry) key_type(key);
+        return inserted;
+    }
+};
+
+// Builds a string right at the top of the storage. As long as nothing else is allocated in between, every append just
+// extends the same buffer in place, and finish() gives the unused bytes back.
+struct Temp_String_Builder
+{
+    Temp_Storage* storage;
+    char*         data;
+    size_t        length;
+    size_t        capacity; // Including the space for the terminating 0.
+
+    Temp_String_Builder() : Temp_String_Builder(temp_get_default_storage()) { }
+    explicit Temp_String_Builder(Temp_Storage* storage) : storage(storage), data(nullptr), length(0), capacity(0) { }
+    // Gives the buffer back if the string was never finished (and it's still on top).
+    ~Temp_String_Builder() { temp_storage_free_size(storage, data, capacity); }
+
+    Temp_String_Builder(const Temp_String_Builder&) = delete;
+    Temp_String_Builder& operator=(const Temp_String_Builder&) = delete;
+
+    // Makes sure there is space for size more characters (and the 0).
+    void reserve(size_t size)
+    {
+        const size_t needed = length + size + 1;
+        if (needed <= capacity)
+            return;
+
+        size_t new_capacity = capacity != 0 ? capacity * 2 : 64;
+        if (new_capacity < needed)
+            new_capacity = needed;
+
+        if (temp_storage_resize_in_place(storage, data, capacity, new_capacity))
+        {
+            capacity = new_capacity;
+            return;
+        }
+
+        // Something else was allocated after us, so we have to move.
+        char* new_data = static_cast<char*>(temp_storage_alloc(storage, new_capacity));
+        if (length != 0)
+            memcpy(new_data, data, length);
+        data = new_data;
+        capacity = new_capacity;
+    }
+
+    Temp_String_Builder& append(const char* string, size_t size)
+    {
+        reserve(size);
+        memcpy(data + length, string, size);
+        length += size;
+        return *this;
+    }
+
+    Temp_String_Builder& append(const char* c_string) { return append(c_string, strlen(c_string)); }
+
+    Temp_String_Builder& append(char c)
+    {
+        reserve(1);
+        data[length] = c;
+        length += 1;
+        return *this;
+    }
+
+    Temp_String_Builder& append_int(long long value)
+    {
+        char digits[24];
+        char* at = digits + sizeof(digits);
+
+        // Go through unsigned, so LLONG_MIN doesn't overflow.
+        unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+        do
+        {
+            *--at = (char)('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude != 0);
+
+        if (value < 0)
+            *--at = '-';
+
+        return append(at, (size_t)(digits + sizeof(digits) - at));
+    }
+
+    Temp_String_Builder& append_fmt(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        append_vfmt(format, args);
+        va_end(args);
+        return *this;
+    }
+
+    Temp_String_Builder& append_vfmt(const char* format, va_list args)
+    {
+        // Try to format straight into the space we already have, most of the time it fits.
+        va_list args_copy;
+        va_copy(args_copy, args);
+        const size_t available = capacity != 0 ? capacity - length : 0;
+        const int size = vsnprintf(available != 0 ? data + length : nullptr, available, format, args_copy);
+        va_end(args_copy);
+
+        if (size < 0)
+            return *this;
+
+        if ((size_t)size >= available)
+        {
+            reserve((size_t)size);
+            vsnprintf(data + length, (size_t)size + 1, format, args);
+        }
+
+        length += (size_t)size;
+        return *this;
+    }
+
+    // Returns the 0 terminated string and gives the unused capacity back. The builder is empty after this.
+    char* finish()
+    {
+        reserve(0);
+        data[length] = 0;
+        temp_storage_resize_in_place(storage, data, capacity, length + 1);
+
+        char* result = data;
+        data = nullptr;
+        length = 0;
+        capacity = 0;
+        return result;
+    }
+};
+
+#if (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)) && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+
+class Temp_Memory_Resource : public std::pmr::memory_resource
+{
+public:
+    // Without a storage the resource uses the default one (of the calling thread, in TEMP_ALLOC_THREAD_LOCAL mode).
+    Temp_Memory_Resource() noexcept : storage(nullptr) { }
+    explicit Temp_Memory_Resource(Temp_Storage* storage) noexcept : storage(storage) { }
+
+    Temp_Storage* get_storage() const noexcept { return storage != nullptr ? storage : temp_get_default_storage(); }
+
+private:
+    Temp_Storage* storage;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (alignment <= ALIGMENT_BYTES)
+            return temp_storage_alloc(get_storage(), bytes);
+        return temp_storage_alloc_aligned(get_storage(), bytes, alignment);
+    }
+
+    void do_deallocate(void* memory, std::size_t bytes, std::size_t) override
+    {
+        temp_storage_free_size(get_storage(), memory, bytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+#if defined(__cpp_rtti) || defined(__GXX_RTTI) || defined(_CPPRTTI)
+        const Temp_Memory_Resource* other_temp = dynamic_cast<const Temp_Memory_Resource*>(&other);
+        return other_temp != nullptr && other_temp->get_storage() == get_storage();
+#else
+        // Without RTTI we can't tell if the other one is ours, so only the same object is equal.
+        return this == &other;
+#endif
+    }
+};
+
+#endif // __has_include(<memory_resource>)
+#endif // C++17
+
+#endif // __cplusplus
+
+#ifdef TEMP_ALLOC_IMPLEMENTATION
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #ifndef MAP_ANONYMOUS
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+    #include <intrin.h>
+    #define _TEMP_ATOMIC_LOAD_PTR(ptr) _InterlockedCompareExchangePointer((void* volatile*)(ptr), NULL, NULL)
+    #ifdef _WIN64
+        #define _TEMP_ATOMIC_FETCH_ADD(ptr, value) (size_t)_InterlockedExchangeAdd64((volatile long long*)(ptr), (long long)(value))
+    #else
+        // size_t is 4 bytes here, a 64 bit add would also touch the field after it.
+        #define _TEMP_ATOMIC_FETCH_ADD(ptr, value) (size_t)_InterlockedExchangeAdd((volatile long*)(ptr), (long)(value))
+    #endif
+    #define _TEMP_ATOMIC_CAS_PTR(ptr, expected, desired) (_InterlockedCompareExchangePointer((void* volatile*)(ptr), (desired), (expected)) == (expected))
+#else
+    #define _TEMP_ATOMIC_LOAD_PTR(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define _TEMP_ATOMIC_FETCH_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_RELAXED)
+    #define _TEMP_ATOMIC_CAS_PTR(ptr, expected, desired) __sync_bool_compare_and_swap((ptr), (expected), (desired))
+#endif
+
+TEMP_THREAD_LOCAL Temp_Storage g_temp_storage;
+
+#ifdef TEMP_ALLOC_THREAD_LOCAL
+// Options that threads use when they lazily initialize their own storage. Set by temp_init().
+static Temp_Options g_temp_thread_options = { 0 };
+
+#ifdef __cplusplus
+struct _Temp_Thread_Storage_Guard
+{
+    ~_Temp_Thread_Storage_Guard() { temp_storage_deinit(&g_temp_storage); }
+};
+static thread_local _Temp_Thread_Storage_Guard g_temp_thread_guard;
+#endif
+#endif
+
+// Returns the default storage for the calling thread. In thread local mode the storage is initialized here on first use.
+static inline Temp_Storage* _temp_default_storage()
+{
+#ifdef TEMP_ALLOC_THREAD_LOCAL
+    if (g_temp_storage.data == NULL)
+    {
+        temp_storage_init_with_options(&g_temp_storage, &g_temp_thread_options);
+#ifdef __cplusplus
+        // Touching the guard registers its destructor for this thread.
+        (void)&g_temp_thread_guard;
+#endif
+    }
+#endif
+    return &g_temp_storage;
+}
+
+//
+// OS virtual memory.
+//
+
+// Reserves address space aligned to the given alignment (only honored on POSIX).
+static void* _temp_os_reserve(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    (void)alignment;
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    const size_t mapped_size = size + alignment;
+    void* memory = mmap(NULL, mapped_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+    if (alignment == 0)
+        return memory;
+
+    // Cut off the unaligned head and the rest of the tail.
+    const uintptr_t start = (uintptr_t)memory;
+    const uintptr_t aligned_start = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if (aligned_start != start)
+        munmap(memory, aligned_start - start);
+    if (aligned_start + size != start + mapped_size)
+        munmap((void*)(aligned_start + size), start + mapped_size - (aligned_start + size));
+
+    return (void*)aligned_start;
+#endif
+}
+
+static bool _temp_os_commit(void* memory, size_t size)
+{
+#ifdef _WIN32
+    return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(memory, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+static void _temp_os_release(void* memory, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#else
+    munmap(memory, size);
+#endif
+}
+
+// Gives the pages back to the OS, they can't be used until committed again.
+static void _temp_os_decommit(void* memory, size_t size)
+{
+#ifdef _WIN32
+    VirtualFree(memory, size, MEM_DECOMMIT);
+#else
+    madvise(memory, size, MADV_DONTNEED);
+    mprotect(memory, size, PROT_NONE);
+#endif
+}
+
+// Gives the physical pages back to the OS, but the memory stays usable (it will be zeroed on the next touch).
+static void _temp_os_discard(void* memory, size_t size)
+{
+#ifdef _WIN32
+    VirtualAlloc(memory, size, MEM_RESET, PAGE_READWRITE);
+#else
+    madvise(memory, size, MADV_DONTNEED);
+#endif
+}
+
+static void _temp_os_advise_huge_pages(void* memory, size_t size, Temp_Page_Backing* backing)
+{
+    *backing = TEMP_PAGES_NORMAL;
+#if defined(MADV_HUGEPAGE)
+    if (madvise(memory, size, MADV_HUGEPAGE) == 0)
+        *backing = TEMP_PAGES_TRANSPARENT_HUGE;
+#else
+    (void)memory;
+    (void)size;
+#endif
+}
+
+// Allocates committed memory backed by huge pages if possible. The size gets rounded up to the huge page size.
+static void* _temp_os_alloc_huge(size_t* size, Temp_Page_Backing* backing)
+{
+#ifdef _WIN32
+    const size_t large_page_size = GetLargePageMinimum();
+    if (large_page_size != 0)
+    {
+        const size_t large_size = (*size + large_page_size - 1) / large_page_size * large_page_size;
+        void* memory = VirtualAlloc(NULL, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (memory != NULL)
+        {
+            *backing = TEMP_PAGES_HUGE;
+            *size = large_size;
+            return memory;
+        }
+    }
+
+    *backing = TEMP_PAGES_NORMAL;
+    return VirtualAlloc(NULL, *size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    const size_t rounded_size = (*size + TEMP_HUGE_PAGE_SIZE - 1) / TEMP_HUGE_PAGE_SIZE * TEMP_HUGE_PAGE_SIZE;
+    void* memory = NULL;
+
+#ifdef MAP_HUGETLB
+    memory = mmap(NULL, rounded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED)
+    {
+        *backing = TEMP_PAGES_HUGE;
+        *size = rounded_size;
+        return memory;
+    }
+#endif
+
+    // No explicit huge pages, ask for transparent ones. They need 2 MB aligned memory.
+    memory = _temp_os_reserve(rounded_size, TEMP_HUGE_PAGE_SIZE);
+    if (memory == NULL)
+        return NULL;
+
+    if (!_temp_os_commit(memory, rounded_size))
+    {
+        _temp_os_release(memory, rounded_size);
+        return NULL;
+    }
+
+    _temp_os_advise_huge_pages(memory, rounded_size, backing);
+    *size = rounded_size;
+    return memory;
+#endif
+}
+
+// Bytes used in the current page.
+static inline size_t _current_size(const Temp_Storage* storage)
+{
+    return (char*)storage->at - (char*)storage->base;
+}
+
+// Has to be called whenever base, max_capacity or the tracking changes.
+static inline void _update_end(Temp_Storage* storage)
+{
+    storage->end = TEMP_TRACKING(storage) ? storage->base : (char*)storage->base + storage->max_capacity;
+}
+
+// The capacity can grow a little if the block is allocated with huge pages.
+static void* _alloc_main_block(Temp_Storage* storage, size_t* capacity)
+{
+    storage->main_block_backing = TEMP_PAGES_NORMAL;
+
+    if (storage->options.backend == TEMP_BACKEND_VIRTUAL)
+    {
+        const size_t alignment = storage->options.huge_pages ? TEMP_HUGE_PAGE_SIZE : 0;
+        void* memory = _temp_os_reserve(*capacity, alignment);
+
+#ifndef _WIN32
+        if (memory != NULL && storage->options.huge_pages)
+            _temp_os_advise_huge_pages(memory, *capacity, &storage->main_block_backing);
+#endif
+
+        storage->reserved_capacity = *capacity;
+        return memory;
+    }
+
+    if (storage->options.huge_pages)
+        return _temp_os_alloc_huge(capacity, &storage->main_block_backing);
+
+    return storage->alloc_proc(*capacity);
+}
+
+static void _free_main_block(Temp_Storage* storage)
+{
+    if (storage->options.backend == TEMP_BACKEND_VIRTUAL)
+        _temp_os_release(storage->data, storage->reserved_capacity);
+    else if (storage->options.huge_pages)
+        _temp_os_release(storage->data, storage->original_capacity);
+    else
+        storage->free_proc(storage->data);
+}
+
+// Allocates the page header and its data in one block.
+static Overflow_Page* _alloc_page_block(Temp_Storage* storage, size_t capacity)
+{
+    size_t block_size = TEMP_PAGE_HEADER_SIZE + capacity;
+    Overflow_Page* page = NULL;
+
+    if (storage->options.huge_pages)
+    {
+        Temp_Page_Backing backing;
+        page = (Overflow_Page*)_temp_os_alloc_huge(&block_size, &backing);
+    }
+    else
+    {
+        page = (Overflow_Page*)storage->alloc_proc(block_size);
+    }
+    assert(page != NULL);
+
+    page->max_capacity = block_size - TEMP_PAGE_HEADER_SIZE;
+    page->data = (char*)page + TEMP_PAGE_HEADER_SIZE;
+    return page;
+}
+
+static void _free_page(Temp_Storage* storage, Overflow_Page* page)
+{
+    if (storage->options.huge_pages)
+        _temp_os_release(page, TEMP_PAGE_HEADER_SIZE + page->max_capacity);
+    else
+        storage->free_proc(page);
+}
+
+// Commits more of the reserved main block so the allocation fits. Returns false if we can't (and need an overflow page).
+static TEMP_NOINLINE bool _commit_more(Temp_Storage* storage, size_t size)
+{
+    if (storage->options.backend != TEMP_BACKEND_VIRTUAL || storage->current_page != NULL)
+        return false;
+
+    // The capacity check is (max_capacity - current size) <= size, so we need one more byte.
+    const size_t needed = _current_size(storage) + size + 1;
+    const size_t granularity = storage->options.huge_pages ? TEMP_HUGE_PAGE_SIZE : TEMP_COMMIT_GRANULARITY;
+    size_t new_capacity = (needed + granularity - 1) / granularity * granularity;
+
+    if (new_capacity > storage->reserved_capacity)
+        new_capacity = storage->reserved_capacity;
+    if (new_capacity < needed)
+        return false;
+
+    char* commit_start = (char*)storage->data + storage->original_capacity;
+    if (!_temp_os_commit(commit_start, new_capacity - storage->original_capacity))
+        return false;
+
+    storage->original_capacity = new_capacity;
+    storage->max_capacity = new_capacity;
+    _update_end(storage);
+    return true;
+}
+
+// Takes the first retained page that can fit the allocation.
+static Overflow_Page* _take_retained_page(Temp_Storage* storage, size_t size)
+{
+    Overflow_Page* prev_page = NULL;
+    Overflow_Page* current_page = storage->retained_pages;
+
+    while (current_page != NULL)
+    {
+        if (current_page->max_capacity > size)
+        {
+            if (prev_page == NULL)
+                storage->retained_pages = (Overflow_Page*)current_page->next;
+            else
+                prev_page->next = current_page->next;
+
+            storage->retained_bytes -= current_page->max_capacity;
+            return current_page;
+        }
+
+        prev_page = current_page;
+        current_page = (Overflow_Page*)current_page->next;
+    }
+
+    return NULL;
+}
+
+// Keeps the page for later if it fits in the retention budget, frees it otherwise.
+static void _release_page(Temp_Storage* storage, Overflow_Page* page)
+{
+    if (storage->retained_bytes + page->max_capacity <= storage->options.page_retention_budget)
+    {
+        page->next = storage->retained_pages;
+        storage->retained_pages = page;
+        storage->retained_bytes += page->max_capacity;
+        return;
+    }
+
+    _free_page(storage, page);
+}
+
+static size_t _first_page_size(Temp_Storage* storage)
+{
+    if (storage->options.page_size != 0)
+        return storage->options.page_size;
+    if (storage->options.backend == TEMP_BACKEND_VIRTUAL)
+        return DEFAULT_TEMP_ALLOC_CAPACITY_SIZE;
+    return storage->original_capacity;
+}
+
+static void _grow_next_page_size(Temp_Storage* storage)
+{
+    if (storage->options.page_growth == TEMP_PAGE_GROWTH_FIXED)
+        return;
+
+    storage->next_page_size *= 2;
+
+    if (storage->options.page_growth == TEMP_PAGE_GROWTH_CAPPED)
+    {
+        size_t max_page_size = storage->options.max_page_size;
+        if (max_page_size == 0)
+            max_page_size = _first_page_size(storage) * TEMP_DEFAULT_MAX_PAGE_SIZE_FACTOR;
+
+        if (storage->next_page_size > max_page_size)
+            storage->next_page_size = max_page_size;
+    }
+}
+
+static Overflow_Page* _alloc_new_page(Temp_Storage* storage, size_t size)
+{
+    Overflow_Page* new_page = _take_retained_page(storage, size);
+
+    if (new_page != NULL)
+    {
+        storage->info.overflow_pages_reused += 1;
+    }
+    else
+    {
+        storage->info.overflow_pages_allocated += 1;
+
+        const size_t page_size = storage->next_page_size;
+        _grow_next_page_size(storage);
+
+        // if we've got a very large allocation, then allocate a block with this size + page_size
+        if (size >= page_size)
+            new_page = _alloc_page_block(storage, size + page_size);
+        else
+            new_page = _alloc_page_block(storage, page_size);
+    }
+
+    new_page->current_size = 0;
+    new_page->at = new_page->data;
+    new_page->next = NULL;
+
+    // The current page is the last one, no need to walk the list.
+    if (storage->current_page == NULL)
+    {
+        assert(storage->overflow_page == NULL);
+        storage->overflow_page = new_page;
+    }
+    else
+    {
+        assert(storage->current_page->next == NULL);
+        storage->current_page->next = new_page;
+    }
+
+    return new_page;
+}
+
+Temp_Storage* temp_storage_create(size_t given_capacity)
+{
+    // The storage object itself always lives in malloc'ed memory, alloc_proc is only used for the blocks it hands out.
+    Temp_Storage* storage = (Temp_Storage*)malloc(sizeof(Temp_Storage));
+    assert(storage != NULL);
+
+    temp_storage_init(storage, given_capacity);
+    return storage;
+}
+
+void temp_storage_destroy(Temp_Storage* storage)
+{
+    temp_storage_deinit(storage);
+    free(storage);
+}
+
+void temp_storage_init(Temp_Storage* storage, size_t given_capacity)
+{
+    Temp_Options options = { 0 };
+    options.capacity = given_capacity;
+    temp_storage_init_with_options(storage, &options);
+}
+
+void temp_storage_init_with_options(Temp_Storage* storage, const Temp_Options* options)
+{
+    size_t capacity = options->capacity;
+    if (capacity == 0 && options->backend == TEMP_BACKEND_VIRTUAL)
+        capacity = DEFAULT_TEMP_ALLOC_RESERVE_SIZE;
+    else if (capacity == 0)
+        capacity = DEFAULT_TEMP_ALLOC_CAPACITY_SIZE;
+
+    *storage = { 0 };
+    storage->options = *options;
+    storage->options.capacity = capacity;
+
+    // Default alloc proc is malloc.
+    temp_storage_set_alloc_proc(storage, &malloc);
+    temp_storage_set_free_proc(storage, &free);
+
+    storage->data = _alloc_main_block(storage, &capacity);
+    storage->base = storage->data;
+    storage->at = storage->data;
+
+    assert(storage->data != NULL);
+
+    // Nothing is committed yet with TEMP_BACKEND_VIRTUAL, the first allocation will do it.
+    if (options->backend == TEMP_BACKEND_VIRTUAL)
+        capacity = 0;
+
+    storage->max_capacity = capacity;
+    storage->overflow_page = NULL;
+    storage->original_capacity = capacity;
+    storage->track_allocation_info = false;
+    _update_end(storage);
+    storage->next_page_size = _first_page_size(storage);
+}
+
+void temp_storage_set_alloc_proc(Temp_Storage* storage, void* (*alloc_proc)(size_t))
+{
+    storage->alloc_proc = alloc_proc;
+}
+void temp_storage_set_free_proc(Temp_Storage* storage, void (*free_proc)(void*))
+{
+    storage->free_proc = free_proc;
+}
+
+void temp_storage_track_allocation_info(Temp_Storage* storage, bool track_status)
+{
+    storage->track_allocation_info = TEMP_ALLOC_TRACK_INFO && track_status;
+    _update_end(storage);
+}
+
+static inline void _track_allocation(Temp_Storage* storage, size_t size_to_alloc, size_t size)
+{
+    if (TEMP_TRACKING(storage))
+    {
+        storage->info.allocation_count += 1;
+        if (size > storage->info.max_allocation)
+            storage->info.max_allocation = size_to_alloc;
+
+        storage->info.total_allocated_bytes += size;
+
+        const size_t used_bytes = storage->frame_used_bytes + _current_size(storage) + size;
+        if (used_bytes > storage->info.peak_used_bytes)
+            storage->info.peak_used_bytes = used_bytes;
+    }
+}
+
+// Moves the allocator to a new overflow page that can fit size bytes.
+// Remembers the tail of the page we're leaving. If all the slots are taken, it replaces the smallest tail.
+static void _keep_tail(Temp_Storage* storage, void* at, size_t size)
+{
+    if (TEMP_TRACKING(storage))
+        storage->info.wasted_bytes += size;
+
+    if (size < TEMP_MIN_TAIL_SIZE)
+        return;
+
+    size_t index = storage->tail_count;
+    if (storage->tail_count == TEMP_MAX_TAILS)
+    {
+        index = 0;
+        for (size_t i = 1; i < TEMP_MAX_TAILS; ++i)
+        {
+            if (storage->tails[i].size < storage->tails[index].size)
+                index = i;
+        }
+
+        if (storage->tails[index].size >= size)
+            return;
+    }
+    else
+    {
+        storage->tail_count += 1;
+    }
+
+    storage->tails[index].at = at;
+    storage->tails[index].size = size;
+}
+
+// Returns NULL if none of the tails can fit the allocation.
+static void* _alloc_from_tail(Temp_Storage* storage, size_t size)
+{
+    for (size_t i = 0; i < storage->tail_count; ++i)
+    {
+        Temp_Tail* tail = &storage->tails[i];
+        if (tail->size < size)
+            continue;
+
+        void* result = tail->at;
+        tail->at = (char*)tail->at + size;
+        tail->size -= size;
+
+        // The tail is in a page we've already left, so it counts towards the frame usage like the rest of that page.
+        storage->frame_used_bytes += size;
+
+        if (tail->size < TEMP_MIN_TAIL_SIZE)
+        {
+            storage->tail_count -= 1;
+            storage->tails[i] = storage->tails[storage->tail_count];
+        }
+
+        if (TEMP_TRACKING(storage))
+            storage->info.tail_reused_bytes += size;
+        return result;
+    }
+
+    return NULL;
+}
+
+static TEMP_NOINLINE void _move_to_new_page(Temp_Storage* storage, size_t size)
+{
+    Overflow_Page* page = _alloc_new_page(storage, size);
+
+    if (storage->at != NULL)
+        _keep_tail(storage, storage->at, storage->max_capacity - _current_size(storage));
+
+    storage->frame_used_bytes += _current_size(storage);
+    storage->current_page = page;
+    storage->base = page->data;
+    storage->at = page->data;
+    storage->max_capacity = page->max_capacity;
+    _update_end(storage);
+}
+
+static inline bool _is_large_allocation(Temp_Storage* storage, size_t size)
+{
+    return storage->options.large_allocation_threshold != 0 && size >= storage->options.large_allocation_threshold;
+}
+
+// Gives the allocation its own block, so the current page stays as it is.
+// The block data is only as aligned as alloc_proc's memory (plus the header), so bigger alignments are padded inside it.
+static TEMP_NOINLINE void* _alloc_large(Temp_Storage* storage, size_t size, size_t alignment)
+{
+    if (TEMP_TRACKING(storage))
+        storage->info.large_allocation_count += 1;
+
+    const size_t block_size = alignment > ALIGMENT_BYTES ? size + alignment - 1 : size;
+    Overflow_Page* page = _take_retained_page(storage, block_size);
+    if (page == NULL)
+        page = _alloc_page_block(storage, block_size);
+
+    const size_t padding = alignment > ALIGMENT_BYTES ? _temp_alignment_padding(page->data, alignment) : 0;
+    if (TEMP_TRACKING(storage))
+        storage->info.alignment_padding_bytes += padding;
+
+    void* result = (char*)page->data + padding;
+    page->current_size = page->max_capacity;
+    page->at = (char*)result + size;
+    page->next = storage->large_pages;
+    storage->large_pages = page;
+
+    return result;
+}
+
+// Releases the large allocation blocks allocated after last_page.
+static void _release_large_pages(Temp_Storage* storage, Overflow_Page* last_page)
+{
+    while (storage->large_pages != last_page)
+    {
+        Overflow_Page* page = storage->large_pages;
+        storage->large_pages = (Overflow_Page*)page->next;
+        _release_page(storage, page);
+    }
+}
+
+void* temp_storage_alloc(Temp_Storage* storage, size_t size_to_alloc)
+{
+    const size_t size = TEMP_ALIGN_SIZE(size_to_alloc);
+    _track_allocation(storage, size_to_alloc, size);
+
+    if (_is_large_allocation(storage, size))
+        return _alloc_large(storage, size, ALIGMENT_BYTES);
+
+    if ((storage->max_capacity - _current_size(storage)) <= size && !_commit_more(storage, size))
+    {
+        void* result = _alloc_from_tail(storage, size);
+        if (result != NULL)
+            return result;
+
+        _move_to_new_page(storage, size);
+    }
+
+    assert(storage->at != NULL);
+    void* result = _temp_bump(storage, size);
+    storage->last_allocation = result;
+    storage->last_allocation_end = storage->at;
+    return result;
+}
+
+void* temp_storage_alloc_aligned(Temp_Storage* storage, size_t size_to_alloc, size_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "alignment has to be a power of two");
+
+    const size_t size = TEMP_ALIGN_SIZE(size_to_alloc);
+    _track_allocation(storage, size_to_alloc, size);
+
+    if (_is_large_allocation(storage, size))
+        return _alloc_large(storage, size, alignment);
+
+    size_t padding = _temp_alignment_padding(storage->at, alignment);
+    if ((storage->max_capacity - _current_size(storage)) <= size + padding && !_commit_more(storage, size + padding))
+    {
+        // Ask for the worst case padding, since we don't know how the page will be aligned.
+        _move_to_new_page(storage, size + alignment - 1);
+        padding = _temp_alignment_padding(storage->at, alignment);
+    }
+
+    if (TEMP_TRACKING(storage))
+        storage->info.alignment_padding_bytes += padding;
+
+    void* result = (char*)storage->at + padding;
+
+    storage->at = (char*)result + size;
+    storage->last_allocation = result;
+    storage->last_allocation_end = storage->at;
+    return result;
+}
+
+char* temp_storage_vprintf(Temp_Storage* storage, const char* format, va_list args)
+{
+    va_list args_copy;
+    va_copy(args_copy, args);
+    size_t buffer_size = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+
+    char* buf = (char*)temp_storage_alloc(storage, buffer_size + 1);
+    vsnprintf(buf, buffer_size+1, format, args);
+
+    buf[buffer_size] = 0;
+    return buf;
+}
+
+char* temp_storage_printf(Temp_Storage* storage, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    char* buf = temp_storage_vprintf(storage, format, args);
+    va_end(args);
+    return buf;
+}
+
+char* temp_storage_copy_string(Temp_Storage* storage, const char* c_string)
+{
+    const size_t c_string_size = strlen(c_string);
+    char* new_string = (char*)temp_storage_alloc(storage, c_string_size + 1);
+    new_string = (char*)memcpy(new_string, c_string, c_string_size);
+    new_string[c_string_size] = 0;
+    return new_string;
+}
+
+char* temp_storage_copy_string_size(Temp_Storage* storage, const char* c_string, size_t size)
+{
+    char* new_string = (char*)temp_storage_alloc(storage, size + 1);
+    new_string = (char*)memcpy(new_string, c_string, size);
+    new_string[size] = 0;
+    return new_string;
+}
+
+// Moves the top of the current page back to memory. It has to be in the current page, below the top.
+static inline void _rewind_to(Temp_Storage* storage, void* memory)
+{
+    storage->at = memory;
+    storage->last_allocation = NULL;
+}
+
+void temp_storage_free(Temp_Storage* storage, void* memory)
+{
+    // We can only give back the last allocation, anything else stays until temp_reset().
+    if (memory != NULL && memory == storage->last_allocation && storage->at == storage->last_allocation_end)
+        _rewind_to(storage, memory);
+}
+
+void temp_storage_free_size(Temp_Storage* storage, void* memory, size_t size)
+{
+    if (memory != NULL && (char*)memory + TEMP_ALIGN_SIZE(size) == (char*)storage->at)
+        _rewind_to(storage, memory);
+}
+
+bool temp_storage_resize_in_place(Temp_Storage* storage, void* memory, size_t old_size, size_t new_size)
+{
+    const size_t old_aligned_size = TEMP_ALIGN_SIZE(old_size);
+
+    // Only the last allocation in the current page can be resized, we just move its end.
+    if (memory == NULL || (char*)memory + old_aligned_size != (char*)storage->at)
+        return false;
+
+    const size_t new_aligned_size = TEMP_ALIGN_SIZE(new_size);
+
+    // A block from before the innermost mark would grow into memory that temp_set_mark() gives back.
+    // Pages after the mark page were all entered after the mark, so only the mark page itself matters.
+    if (new_aligned_size > old_aligned_size && storage->mark_at != NULL &&
+        storage->current_page == storage->mark_page && (char*)memory < (char*)storage->mark_at)
+        return false;
+    const size_t start = _current_size(storage) - old_aligned_size;
+
+    bool fits = (storage->max_capacity - start) > new_aligned_size;
+    if (!fits && new_aligned_size > old_aligned_size)
+        fits = _commit_more(storage, new_aligned_size - old_aligned_size);
+
+    if (!fits)
+        return false;
+
+    if (TEMP_TRACKING(storage))
+        storage->info.realloc_in_place_count += 1;
+
+    storage->at = (char*)memory + new_aligned_size;
+    storage->last_allocation = memory;
+    storage->last_allocation_end = storage->at;
+    return true;
+}
+
+void* temp_storage_realloc(Temp_Storage* storage, void* old_memory, size_t old_size, size_t new_size)
+{
+    if (temp_storage_resize_in_place(storage, old_memory, old_size, new_size))
+        return old_memory;
+
+    if (TEMP_TRACKING(storage))
+        storage->info.realloc_copy_count += 1;
+
+    void* memory = temp_storage_alloc(storage, new_size);
+    return memcpy(memory, old_memory, old_size < new_size ? old_size : new_size);
+}
+
+Temp_Alloc_Info temp_storage_get_alloc_info(Temp_Storage* storage)
+{
+    Temp_Alloc_Info info = { 0 };
+    if (TEMP_TRACKING(storage) && storage->info.allocation_count > 0)
+    {
+        info = storage->info;
+        info.average_allocation = info.total_allocated_bytes / info.allocation_count;
+    }
+    info.main_block_backing = storage->main_block_backing;
+    info.trimmed_bytes = storage->trimmed_bytes;
+    return info;
+}
+
+// Remembers how much memory is in use right now before it goes away with temp_reset() or temp_set_mark().
+static void _note_usage(Temp_Storage* storage)
+{
+    const size_t frame_used = storage->frame_used_bytes + _current_size(storage);
+    if (frame_used > storage->frame_peak_bytes)
+        storage->frame_peak_bytes = frame_used;
+
+    // If we've left the main block, it was used up to the end.
+    const size_t main_used = storage->current_page != NULL ? storage->original_capacity : _current_size(storage);
+    if (main_used > storage->main_touched_size)
+        storage->main_touched_size = main_used;
+}
+
+static void _update_high_water_mark(Temp_Storage* storage)
+{
+    const size_t frame_used = storage->frame_peak_bytes;
+
+    if (frame_used >= storage->high_water_mark)
+        storage->high_water_mark = frame_used;
+    else
+        storage->high_water_mark -= (storage->high_water_mark - frame_used) >> TEMP_ADAPTIVE_DECAY_SHIFT;
+}
+
+// NOTE: All overflow pages have to be released before calling this.
+static void _adapt_main_block(Temp_Storage* storage)
+{
+    const size_t target_capacity = storage->high_water_mark + storage->high_water_mark / 100 * TEMP_ADAPTIVE_GROW_PERCENT;
+    size_t new_capacity = storage->original_capacity;
+
+    if (storage->high_water_mark > storage->original_capacity)
+    {
+        // The frame didn't fit, grow.
+        new_capacity = target_capacity;
+    }
+    else if (storage->high_water_mark * TEMP_ADAPTIVE_SHRINK_RATIO < storage->original_capacity)
+    {
+        // We've been using a lot less for a while, shrink.
+        new_capacity = target_capacity;
+        if (new_capacity < storage->options.capacity)
+            new_capacity = storage->options.capacity;
+    }
+
+    if (new_capacity == storage->original_capacity)
+        return;
+
+    _free_main_block(storage);
+    storage->data = _alloc_main_block(storage, &new_capacity);
+    assert(storage->data != NULL);
+
+    storage->original_capacity = new_capacity;
+    storage->main_touched_size = 0;
+}
+
+static void _trim_memory(Temp_Storage* storage)
+{
+    const size_t granularity = storage->options.huge_pages ? TEMP_HUGE_PAGE_SIZE : TEMP_COMMIT_GRANULARITY;
+    const size_t keep_size = (storage->high_water_mark + granularity - 1) / granularity * granularity;
+
+    if (storage->options.backend == TEMP_BACKEND_VIRTUAL)
+    {
+        if (keep_size < storage->original_capacity && storage->original_capacity - keep_size >= TEMP_TRIM_MIN_BYTES)
+        {
+            _temp_os_decommit((char*)storage->data + keep_size, storage->original_capacity - keep_size);
+            storage->trimmed_bytes += storage->original_capacity - keep_size;
+            storage->original_capacity = keep_size;
+        }
+    }
+    else if (storage->options.huge_pages)
+    {
+        // We've mapped this block ourselves, so we can discard its tail.
+        if (keep_size < storage->main_touched_size && storage->main_touched_size - keep_size >= TEMP_TRIM_MIN_BYTES)
+        {
+            _temp_os_discard((char*)storage->data + keep_size, storage->main_touched_size - keep_size);
+            storage->trimmed_bytes += storage->main_touched_size - keep_size;
+            storage->main_touched_size = keep_size;
+        }
+    }
+
+    // Free the retained pages we don't expect to need.
+    size_t needed_page_bytes = 0;
+    if (storage->high_water_mark > storage->original_capacity)
+        needed_page_bytes = storage->high_water_mark - storage->original_capacity;
+
+    while (storage->retained_pages != NULL && storage->retained_bytes > needed_page_bytes)
+    {
+        Overflow_Page* page = storage->retained_pages;
+        storage->retained_pages = (Overflow_Page*)page->next;
+        storage->retained_bytes -= page->max_capacity;
+        storage->trimmed_bytes += page->max_capacity;
+        _free_page(storage, page);
+    }
+}
+
+// Frees the overflow and large pages of this frame, or keeps them for the next frames.
+static void _release_frame_pages(Temp_Storage* storage)
+{
+    _release_large_pages(storage, NULL);
+
+    Overflow_Page* current_page = storage->overflow_page;
+    while (current_page != NULL)
+    {
+        Overflow_Page* next_page = (Overflow_Page*)current_page->next;
+        _release_page(storage, current_page);
+        current_page = next_page;
+    }
+
+    storage->overflow_page = NULL;
+    storage->current_page = NULL;
+    storage->tail_count = 0;
+}
+
+void temp_storage_reset(Temp_Storage* storage)
+{
+    _note_usage(storage);
+    _release_frame_pages(storage);
+    _update_high_water_mark(storage);
+
+    if (storage->options.adaptive_capacity && storage->options.backend == TEMP_BACKEND_HEAP)
+        _adapt_main_block(storage);
+    if (storage->options.trim_memory)
+        _trim_memory(storage);
+
+    // Reset the storage.
+    storage->last_allocation = NULL;
+    storage->mark_page = NULL;
+    storage->mark_at = NULL;
+    storage->frame_used_bytes = 0;
+    storage->frame_peak_bytes = 0;
+    storage->base = storage->data;
+    storage->at = storage->data;
+    storage->max_capacity = storage->original_capacity;
+    storage->next_page_size = _first_page_size(storage);
+
+    // Reset allocation info.
+    if (TEMP_TRACKING(storage))
+        storage->info = { 0 };
+
+    _update_end(storage);
+}
+
+Temp_Mark temp_storage_get_mark(Temp_Storage* storage)
+{
+    Temp_Mark mark;
+    mark.page = storage->current_page;
+    mark.large_page = storage->large_pages;
+    mark.at = storage->at;
+    mark.frame_used_bytes = storage->frame_used_bytes;
+    mark.previous_mark_page = storage->mark_page;
+    mark.previous_mark_at = storage->mark_at;
+
+    storage->mark_page = storage->current_page;
+    storage->mark_at = storage->at;
+    return mark;
+}
+
+void temp_storage_set_mark(Temp_Storage* storage, Temp_Mark mark)
+{
+    _note_usage(storage);
+    _release_large_pages(storage, mark.large_page);
+
+    // Release the pages allocated after the mark.
+    Overflow_Page* current_page = mark.page != NULL ? (Overflow_Page*)mark.page->next : storage->overflow_page;
+    while (current_page != NULL)
+    {
+        Overflow_Page* next_page = (Overflow_Page*)current_page->next;
+        _release_page(storage, current_page);
+        current_page = next_page;
+    }
+
+    if (mark.page != NULL)
+    {
+        mark.page->next = NULL;
+        storage->base = mark.page->data;
+        storage->max_capacity = mark.page->max_capacity;
+    }
+    else
+    {
+        storage->overflow_page = NULL;
+        storage->base = storage->data;
+        storage->max_capacity = storage->original_capacity;
+    }
+
+    // The tails might be in the pages we've just released.
+    storage->tail_count = 0;
+    storage->current_page = mark.page;
+    storage->last_allocation = NULL;
+    storage->at = mark.at;
+    storage->frame_used_bytes = mark.frame_used_bytes;
+    storage->mark_page = mark.previous_mark_page;
+    storage->mark_at = mark.previous_mark_at;
+    _update_end(storage);
+}
+
+void temp_storage_deinit(Temp_Storage* storage)
+{
+    // Never initialized (a thread that didn't allocate in TEMP_ALLOC_THREAD_LOCAL mode) or already deinitialized.
+    if (storage->data == NULL)
+        return;
+
+    // No temp_storage_reset() here, adapting or trimming the main block right before freeing it is wasted work.
+    _release_frame_pages(storage);
+
+    Overflow_Page* current_page = storage->retained_pages;
+    while (current_page != NULL)
+    {
+        Overflow_Page* next_page = (Overflow_Page*)current_page->next;
+        _free_page(storage, current_page);
+        current_page = next_page;
+    }
+    storage->retained_pages = NULL;
+    storage->retained_bytes = 0;
+
+    _free_main_block(storage);
+
+    storage->data = NULL;
+    storage->base = NULL;
+    storage->at = NULL;
+    storage->end = NULL;
+    storage->last_allocation = NULL;
+    storage->mark_page = NULL;
+    storage->mark_at = NULL;
+    storage->max_capacity = 0;
+    storage->original_capacity = 0;
+    storage->reserved_capacity = 0;
+}
+
+//
+// Concurrent storage.
+//
+
+// The page header and the page data live in one block: [Overflow_Page][data...]
+static Overflow_Page* _alloc_concurrent_page(Temp_Concurrent_Storage* storage, size_t capacity)
+{
+    Overflow_Page* page = (Overflow_Page*)storage->alloc_proc(sizeof(Overflow_Page) + capacity);
+    assert(page != NULL);
+
+    page->current_size = 0;
+    page->max_capacity = capacity;
+    page->data = page + 1;
+    page->at = page->data;
+    page->next = NULL;
+    return page;
+}
+
+void temp_concurrent_init(Temp_Concurrent_Storage* storage, size_t given_capacity)
+{
+    size_t capacity = given_capacity;
+    if (given_capacity == 0)
+        capacity = DEFAULT_TEMP_ALLOC_CAPACITY_SIZE;
+
+    storage->alloc_proc = &malloc;
+    storage->free_proc = &free;
+    storage->page_capacity = capacity;
+
+    storage->main_page = _alloc_concurrent_page(storage, capacity);
+    storage->current_page = storage->main_page;
+}
+
+void* temp_concurrent_alloc(Temp_Concurrent_Storage* storage, size_t size_to_alloc)
+{
+    const size_t size = TEMP_ALIGN_SIZE(size_to_alloc);
+
+    while (true)
+    {
+        Overflow_Page* page = (Overflow_Page*)_TEMP_ATOMIC_LOAD_PTR(&storage->current_page);
+
+        const size_t offset = _TEMP_ATOMIC_FETCH_ADD(&page->current_size, size);
+        if (offset + size <= page->max_capacity)
+            return (char*)page->data + offset;
+
+        // The page is full. If some other thread has already installed a new one, just allocate from that.
+        if ((Overflow_Page*)_TEMP_ATOMIC_LOAD_PTR(&storage->current_page) != page)
+            continue;
+
+        // Allocate a new one with our allocation already in it and try to install it.
+        // If some other thread was faster, we drop our page and allocate from theirs.
+        size_t capacity = storage->page_capacity;
+        if (size > capacity)
+            capacity = size + storage->page_capacity;
+
+        Overflow_Page* new_page = _alloc_concurrent_page(storage, capacity);
+        new_page->current_size = size;
+        new_page->next = page;
+
+        if (_TEMP_ATOMIC_CAS_PTR(&storage->current_page, page, new_page))
+            return new_page->data;
+
+        storage->free_proc(new_page);
+    }
+}
+
+void temp_concurrent_reset(Temp_Concurrent_Storage* storage)
+{
+    // NOTE: No thread may allocate from the storage while it is being reset.
+    Overflow_Page* current_page = storage->current_page;
+    while (current_page != storage->main_page)
+    {
+        Overflow_Page* next_page = (Overflow_Page*)current_page->next;
+        storage->free_proc(current_page);
+        current_page = next_page;
+    }
+
+    storage->main_page->current_size = 0;
+    storage->current_page = storage->main_page;
+}
+
+void temp_concurrent_deinit(Temp_Concurrent_Storage* storage)
+{
+    temp_concurrent_reset(storage);
+    storage->free_proc(storage->main_page);
+
+    storage->main_page = NULL;
+    storage->current_page = NULL;
+}
+
+//
+// Default storage wrappers.
+//
+
+Temp_Storage* temp_get_default_storage()
+{
+    return _temp_default_storage();
+}
+
+void temp_init(size_t given_capacity)
+{
+    Temp_Options options = { 0 };
+    options.capacity = given_capacity;
+    temp_init_with_options(&options);
+}
+
+void temp_init_with_options(const Temp_Options* options)
+{
+#ifdef TEMP_ALLOC_THREAD_LOCAL
+    g_temp_thread_options = *options;
+#endif
+    temp_storage_init_with_options(&g_temp_storage, options);
+}
+
+void temp_set_alloc_proc(void* (*alloc_proc)(size_t))
+{
+    temp_storage_set_alloc_proc(_temp_default_storage(), alloc_proc);
+}
+void temp_set_free_proc(void (*free_proc)(void*))
+{
+    temp_storage_set_free_proc(_temp_default_storage(), free_proc);
+}
+
+void temp_track_allocation_info(bool track_status)
+{
+    temp_storage_track_allocation_info(_temp_default_storage(), track_status);
+}
+
+void* temp_alloc(size_t size_to_alloc)
+{
+    return temp_storage_alloc(_temp_default_storage(), size_to_alloc);
+}
+
+void* temp_alloc_aligned(size_t size_to_alloc, size_t alignment)
+{
+    return temp_storage_alloc_aligned(_temp_default_storage(), size_to_alloc, alignment);
+}
+
+char* temp_printf(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    char* buf = temp_storage_vprintf(_temp_default_storage(), format, args);
+    va_end(args);
+    return buf;
+}
+
+char* temp_copy_string(const char* c_string)
+{
+    return temp_storage_copy_string(_temp_default_storage(), c_string);
+}
+
+char* temp_copy_string_size(const char* c_string, size_t size)
+{
+    return temp_storage_copy_string_size(_temp_default_storage(), c_string, size);
+}
+
+void temp_free(void* memory)
+{
+    temp_storage_free(_temp_default_storage(), memory);
+}
+
+void temp_free_size(void* memory, size_t size)
+{
+    temp_storage_free_size(_temp_default_storage(), memory, size);
+}
+
+void* temp_realloc(void* old_memory, size_t old_size, size_t new_size)
+{
+    return temp_storage_realloc(_temp_default_storage(), old_memory, old_size, new_size);
+}
+
+bool temp_resize_in_place(void* memory, size_t old_size, size_t new_size)
+{
+    return temp_storage_resize_in_place(_temp_default_storage(), memory, old_size, new_size);
+}
+
+Temp_Mark temp_get_mark()
+{
+    return temp_storage_get_mark(_temp_default_storage());
+}
+
+void temp_set_mark(Temp_Mark mark)
+{
+    temp_storage_set_mark(_temp_default_storage(), mark);
+}
+
+Temp_Alloc_Info temp_get_alloc_info()
+{
+    return temp_storage_get_alloc_info(&g_temp_storage);
+}
+
+void temp_reset()
+{
+    temp_storage_reset(&g_temp_storage);
+}
+
+void temp_deinit()
+{
+    temp_storage_deinit(&g_temp_storage);
 }
 
 #endif // TEMP_ALLOC_IMPLEMENTATION
@@ -0,0 +1,57 @@
+// Build and run: c++ -std=c++11 -I.. temp_adaptive_test.cpp -o temp_adaptive_test && ./temp_adaptive_test
+#define TEMP_ALLOC_IMPLEMENTATION
+#include "temp_alloc.h"
+
+#include <stdio.h>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures += 1; } } while (0)
+
+static const size_t MB = 1024 * 1024;
+static const int    ALLOCATIONS_PER_FRAME = 300;
+
+static void run_frame()
+{
+    for (int i = 0; i < ALLOCATIONS_PER_FRAME; i++)
+        temp_alloc(MB);
+}
+
+// A 1 MB block and 300 x 1 MB allocations: half of them land in the tails of the overflow pages.
+// They have to be counted, otherwise the main block grows to half the frame and the next frame overflows again.
+static void test_adaptive_block_covers_frame_after_one_reset()
+{
+    Temp_Storage* storage = temp_get_default_storage();
+
+    run_frame();
+    CHECK(storage->info.peak_used_bytes >= ALLOCATIONS_PER_FRAME * MB);
+    temp_reset();
+
+    CHECK(storage->high_water_mark >= ALLOCATIONS_PER_FRAME * MB);
+    CHECK(storage->original_capacity >= ALLOCATIONS_PER_FRAME * MB);
+
+    run_frame();
+    CHECK(storage->overflow_page == NULL);
+    CHECK(storage->info.overflow_pages_allocated == 0);
+    CHECK(storage->info.overflow_pages_reused == 0);
+    temp_reset();
+}
+
+int main()
+{
+    Temp_Options options = { 0 };
+    options.capacity = MB;
+    options.adaptive_capacity = true;
+    temp_init_with_options(&options);
+    temp_track_allocation_info(true);
+
+    test_adaptive_block_covers_frame_after_one_reset();
+
+    temp_deinit();
+
+    if (failures != 0)
+        return 1;
+    printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Build and run: c++ -std=c++11 -I.. temp_array_scope_test.cpp -o temp_array_scope_test && ./temp_array_scope_test
+#define TEMP_ALLOC_IMPLEMENTATION
+#include "temp_alloc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures += 1; } } while (0)
+
+// An array that outlives a scope and grows inside it (within its reserved capacity) keeps all its elements.
+static void test_array_grows_inside_scope()
+{
+    Temp_Array<int> arr;
+    arr.reserve(64);
+    for (int i = 0; i < 8; i++)
+        arr.push_back(i);
+
+    int* data = arr.data;
+    {
+        Temp_Scope scope;
+        for (int i = 8; i < 64; i++)
+            arr.push_back(i);
+
+        // It's below the mark, so it must not be grown in place past it.
+        CHECK(!temp_resize_in_place(arr.data, arr.capacity * sizeof(int), 2 * arr.capacity * sizeof(int)));
+
+        memset(temp_alloc(128), 0xAB, 128);
+    }
+
+    memset(temp_alloc(256), 0xCD, 256);
+
+    CHECK(arr.data == data);
+    CHECK(arr.size() == 64);
+    for (int i = 0; i < 64; i++)
+        CHECK(arr[i] == i);
+}
+
+// The same with the plain C api: a block from before the mark isn't extended past the mark.
+static void test_realloc_across_mark()
+{
+    char* block = (char*)temp_alloc(16);
+    memset(block, 1, 16);
+
+    Temp_Mark mark = temp_get_mark();
+    char* grown = (char*)temp_realloc(block, 16, 1024);
+    CHECK(grown != block);
+    temp_set_mark(mark);
+
+    memset(temp_alloc(1024), 2, 1024);
+    for (int i = 0; i < 16; i++)
+        CHECK(block[i] == 1);
+}
+
+// Blocks allocated after the mark still grow in place.
+static void test_array_inside_scope_grows_in_place()
+{
+    Temp_Scope scope;
+    Temp_Array<int> arr;
+    arr.reserve(8);
+    int* data = arr.data;
+    for (int i = 0; i < 1000; i++)
+        arr.push_back(i);
+
+    CHECK(arr.data == data);
+    for (int i = 0; i < 1000; i++)
+        CHECK(arr[i] == i);
+}
+
+int main()
+{
+    temp_init(1024 * 1024);
+
+    test_array_grows_inside_scope();
+    temp_reset();
+    test_realloc_across_mark();
+    temp_reset();
+    test_array_inside_scope_grows_in_place();
+
+    temp_deinit();
+
+    if (failures != 0)
+        return 1;
+    printf("ok\n");
+    return 0;
+}
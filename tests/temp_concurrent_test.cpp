@@ -0,0 +1,101 @@
+// Build and run: c++ -std=c++11 -I.. temp_concurrent_test.cpp -o temp_concurrent_test -pthread && ./temp_concurrent_test
+#define TEMP_ALLOC_IMPLEMENTATION
+#include "temp_alloc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures += 1; } } while (0)
+
+static const int    THREAD_COUNT = 8;
+static const int    ALLOCATIONS_PER_THREAD = 2000;
+static const int    FRAMES = 4;
+static const size_t PAGE_CAPACITY = 64 * 1024; // Small, so the threads install lots of pages.
+
+struct Block
+{
+    unsigned char* memory;
+    size_t         size;
+};
+
+static unsigned char block_pattern(int thread, int index)
+{
+    return (unsigned char)(thread * 31 + index * 7 + 1);
+}
+
+static size_t block_size(int thread, int index)
+{
+    // Every thread asks for one block bigger than a whole page.
+    if (index == ALLOCATIONS_PER_THREAD / 2)
+        return PAGE_CAPACITY + 1000 + thread;
+    return 1 + (size_t)((thread * 131 + index * 17) % 300);
+}
+
+// Every block is filled with its own pattern while the other threads allocate, so overlapping blocks show up after the join.
+static void test_concurrent_blocks_dont_overlap()
+{
+    Temp_Concurrent_Storage storage = { 0 };
+    temp_concurrent_init(&storage, PAGE_CAPACITY);
+
+    std::vector<std::vector<Block>> blocks(THREAD_COUNT);
+
+    for (int frame = 0; frame < FRAMES; frame++)
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREAD_COUNT; t++)
+        {
+            blocks[t].clear();
+            threads.emplace_back([&storage, &blocks, t]()
+            {
+                for (int i = 0; i < ALLOCATIONS_PER_THREAD; i++)
+                {
+                    Block block;
+                    block.size = block_size(t, i);
+                    block.memory = (unsigned char*)temp_concurrent_alloc(&storage, block.size);
+                    memset(block.memory, block_pattern(t, i), block.size);
+                    blocks[t].push_back(block);
+                }
+            });
+        }
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        // Some pages were installed on top of the main page.
+        CHECK(storage.current_page != storage.main_page);
+
+        for (int t = 0; t < THREAD_COUNT; t++)
+        {
+            for (int i = 0; i < ALLOCATIONS_PER_THREAD; i++)
+            {
+                const Block& block = blocks[t][i];
+                CHECK(((uintptr_t)block.memory & (ALIGMENT_BYTES - 1)) == 0);
+
+                bool intact = true;
+                for (size_t j = 0; j < block.size; j++)
+                    intact = intact && block.memory[j] == block_pattern(t, i);
+                CHECK(intact);
+            }
+        }
+
+        temp_concurrent_reset(&storage);
+        CHECK(storage.current_page == storage.main_page);
+    }
+
+    temp_concurrent_deinit(&storage);
+}
+
+int main()
+{
+    test_concurrent_blocks_dont_overlap();
+
+    if (failures != 0)
+        return 1;
+    printf("ok\n");
+    return 0;
+}
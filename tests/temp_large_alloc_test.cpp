@@ -0,0 +1,91 @@
+// Build and run: c++ -std=c++11 -I.. temp_large_alloc_test.cpp -o temp_large_alloc_test && ./temp_large_alloc_test
+#define TEMP_ALLOC_IMPLEMENTATION
+#include "temp_alloc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { if (!(condition)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); failures += 1; } } while (0)
+
+static const size_t THRESHOLD = 64 * 1024;
+
+static bool is_filled(const unsigned char* memory, size_t size, unsigned char value)
+{
+    for (size_t i = 0; i < size; i++)
+        if (memory[i] != value)
+            return false;
+    return true;
+}
+
+// Large aligned allocations get their own block, and they are aligned inside it.
+static void test_large_aligned_allocations()
+{
+    Temp_Storage* storage = temp_get_default_storage();
+
+    for (size_t alignment = 16; alignment <= 4096; alignment *= 2)
+    {
+        void* memory = temp_alloc_aligned(THRESHOLD, alignment);
+        CHECK(((uintptr_t)memory & (alignment - 1)) == 0);
+    }
+    CHECK(storage->large_pages != NULL);
+
+    temp_reset();
+}
+
+// A large block from before a mark survives temp_set_mark(), the ones after it are released.
+static void test_large_block_and_marks()
+{
+    Temp_Storage* storage = temp_get_default_storage();
+
+    unsigned char* kept = (unsigned char*)temp_alloc_aligned(THRESHOLD, 64);
+    CHECK(((uintptr_t)kept & 63) == 0);
+    memset(kept, 0x11, THRESHOLD);
+    Overflow_Page* kept_page = storage->large_pages;
+
+    Temp_Mark mark = temp_get_mark();
+    unsigned char* scratch = (unsigned char*)temp_alloc_aligned(2 * THRESHOLD, 64);
+    CHECK(((uintptr_t)scratch & 63) == 0);
+    memset(scratch, 0x22, 2 * THRESHOLD);
+    temp_set_mark(mark);
+
+    CHECK(storage->large_pages == kept_page);
+    CHECK(is_filled(kept, THRESHOLD, 0x11));
+
+    // The block after the mark went to the retained pages, and it's still aligned when it's reused.
+    unsigned char* reused = (unsigned char*)temp_alloc_aligned(THRESHOLD, 64);
+    CHECK(((uintptr_t)reused & 63) == 0);
+    memset(reused, 0x33, THRESHOLD);
+    CHECK(is_filled(kept, THRESHOLD, 0x11));
+
+    // temp_reset() releases all of them.
+    temp_reset();
+    CHECK(storage->large_pages == NULL);
+
+    unsigned char* after_reset = (unsigned char*)temp_alloc_aligned(THRESHOLD, 64);
+    CHECK(((uintptr_t)after_reset & 63) == 0);
+    memset(after_reset, 0x44, THRESHOLD);
+
+    temp_reset();
+}
+
+int main()
+{
+    Temp_Options options = { 0 };
+    options.capacity = 1024 * 1024;
+    options.large_allocation_threshold = THRESHOLD;
+    options.page_retention_budget = 16 * 1024 * 1024;
+    temp_init_with_options(&options);
+
+    test_large_aligned_allocations();
+    test_large_block_and_marks();
+
+    temp_deinit();
+
+    if (failures != 0)
+        return 1;
+    printf("ok\n");
+    return 0;
+}